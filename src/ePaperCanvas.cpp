@@ -18,6 +18,49 @@
 
 const uint8_t ePaperCanvas::bitmasks[] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
 
+// plane bits of white, gray 1, gray 2, black, color and any other color. colors the
+// mode does not have draw nothing with drawPixel(), and white with lines and fills.
+template<> const ePaperColorBits ePaperCanvasT<CMODE_BW>::colorBits[ePaper_COLOR_INDEX_COUNT] = {
+	{0x00, 0x00, 0xFF},
+	{0x00, 0x00, 0x00},
+	{0x00, 0x00, 0x00},
+	{0xFF, 0x00, 0xFF},
+	{0x00, 0x00, 0x00},
+	{0x00, 0x00, 0x00}
+};
+
+template<> const ePaperColorBits ePaperCanvasT<CMODE_3COLOR>::colorBits[ePaper_COLOR_INDEX_COUNT] = {
+	{0x00, 0x00, 0xFF},
+	{0x00, 0x00, 0x00},
+	{0x00, 0x00, 0x00},
+	{0xFF, 0x00, 0xFF},
+	{0x00, 0xFF, 0xFF},
+	{0x00, 0x00, 0x00}
+};
+
+// black sets the bits of both planes, gray 1 only the color plane's and gray 2 only
+// the black plane's
+template<> const ePaperColorBits ePaperCanvasT<CMODE_4GRAY>::colorBits[ePaper_COLOR_INDEX_COUNT] = {
+	{0x00, 0x00, 0xFF},
+	{0x00, 0xFF, 0xFF},
+	{0xFF, 0x00, 0xFF},
+	{0xFF, 0xFF, 0xFF},
+	{0x00, 0x00, 0x00},
+	{0x00, 0x00, 0x00}
+};
+
+static const ePaperColorBits *colorBitsForMode(ePaperColorMode mode)
+{
+	switch (mode) {
+		case CMODE_3COLOR:
+			return ePaperCanvasT<CMODE_3COLOR>::colorBits;
+		case CMODE_4GRAY:
+			return ePaperCanvasT<CMODE_4GRAY>::colorBits;
+		default:
+			return ePaperCanvasT<CMODE_BW>::colorBits;
+	}
+}
+
 ePaperCanvas::ePaperCanvas(
 	int16_t w,
 	int16_t h,
@@ -26,8 +69,23 @@ ePaperCanvas::ePaperCanvas(
 		_bufferSize(0),
 		_blackBuffer(NULL),
 		_colorBuffer(NULL),
-		_mode(mode)
+		_mode(mode),
+		_colorBits(colorBitsForMode(mode)),
+		_rotationMode(ROTATE_ON_DRAW),
+		_sendRotation(0),
+		_bufferWidth(w),
+		_bufferHeight(h),
+		_rowBytes((w + 7)/8),
+		_dirtyX0(0),
+		_dirtyY0(0),
+		_dirtyX1(0),
+		_dirtyY1(0),
+		_blackPlaneModified(true),
+		_colorPlaneModified(true),
+		_textCache(nullptr)
 {
+	clearDirtyRect();
+
 	DEBUG_PRINT(F("Creating ePaperCanvas object with w = "));
 	DEBUG_PRINT(w);
 	DEBUG_PRINT(F(", h = "));
@@ -80,168 +138,116 @@ ePaperCanvas::~ePaperCanvas()
 	}
 }
 
+/*!
+    @brief  Draws a pixel, with the pixel writes of the canvas' color mode.
+    @note   ePaperDisplayT, whose color mode is known when compiling, calls
+    		drawPixelInMode() directly instead.
+*/
 void ePaperCanvas::drawPixel(int16_t x, int16_t y, ePaperColorType color)
 {
-	if((x >= 0) && (x < width()) && (y >= 0) && (y < height())) {
-		// Pixel is in-bounds. Rotate coordinates if needed.
-		switch(getRotation()) {
-			case 1:
-				swap_coordinates(x, y);
-				x = WIDTH - x - 1;
-				break;
-			case 2:
-				x = WIDTH  - x - 1;
-				y = HEIGHT - y - 1;
-				break;
-			case 3:
-				swap_coordinates(x, y);
-				y = HEIGHT - y - 1;
-				break;
-		}
-		uint32_t bit_index = ((int32_t)y*WIDTH + x);
-		uint32_t buffer_index = bit_index/8;
-		int8_t buffer_bit_mask = (1 << ((7-(y*WIDTH + x))&7));
-		
-		switch(color) {
-			case ePaper_WHITE:
-				// setting white is turning the black pixel off
-				_blackBuffer[buffer_index] &= ~(buffer_bit_mask); 
-				if ((getColorMode() == CMODE_3COLOR)||(getColorMode() == CMODE_4GRAY)) {
-					// turn the color off where we set white
-					_colorBuffer[buffer_index] &= ~(buffer_bit_mask); 
-				} 
-				break;
-			case ePaper_BLACK:
-				// turn appropriate black pixel on
-				_blackBuffer[buffer_index] |=  (buffer_bit_mask);
-				if (getColorMode() == CMODE_3COLOR) {
-					// turn the color off where we set black
-					_colorBuffer[buffer_index] &= ~(buffer_bit_mask); 
-				} else if (getColorMode() == CMODE_4GRAY) {
-					// turn the color on where we set black
-					_colorBuffer[buffer_index] |=  (buffer_bit_mask);
-				}
-				break;
-			case ePaper_GRAY1:
-				if (getColorMode() == CMODE_4GRAY) {
-					// white is off, color is on
-					_blackBuffer[buffer_index] &= ~(buffer_bit_mask); 
-					_colorBuffer[buffer_index] |=  (buffer_bit_mask);
-				}
-				break;
-			case ePaper_GRAY2:
-				if (getColorMode() == CMODE_4GRAY) {
-					// white is on, color is off
-					_blackBuffer[buffer_index] |=  (buffer_bit_mask);
-					_colorBuffer[buffer_index] &= ~(buffer_bit_mask); 
-				}
-				break;
-			case ePaper_COLOR:
-				if (getColorMode() == CMODE_3COLOR) {
-					// make sure black pixel is off
-					_blackBuffer[buffer_index] &= ~(buffer_bit_mask); 
-					if (_colorBuffer) {
-						// turn the color on 
-						_colorBuffer[buffer_index] |=  (buffer_bit_mask);
-					}
-				}
-				break;
-			case ePaper_INVERSE1:
-				// b -> w, w -> b, c -> w
-				// to set the inverse, first see if the pixel has the color. If it does,
-				// invert that (set to white). Otherwise, invert the B&W image.
-				if (_colorBuffer) {
-					if (_colorBuffer[buffer_index]&buffer_bit_mask) {
-						_colorBuffer[buffer_index] &= ~(buffer_bit_mask); 
-						break;
-					}
-				}
-				_blackBuffer[buffer_index] ^= buffer_bit_mask;
-				break;
-			case ePaper_INVERSE2:
-				// b -> c or w, w -> b, c -> b
-				if (_colorBuffer) {
-					if (_colorBuffer[buffer_index]&buffer_bit_mask) {
-						_colorBuffer[buffer_index] &= ~(buffer_bit_mask); 
-						_blackBuffer[buffer_index] |= buffer_bit_mask;
-						break;
-					}
-				}
-				if (_blackBuffer[buffer_index]&buffer_bit_mask) {
-					_blackBuffer[buffer_index] &= ~(buffer_bit_mask); 
-					if (_colorBuffer) {
-						_colorBuffer[buffer_index] |= buffer_bit_mask;
-					}
-				}
-				else {
-					_blackBuffer[buffer_index] |= buffer_bit_mask;
-				}
-				break;
-			case ePaper_INVERSE3:
-				// b -> w, w -> c or b, c -> b
-				if (_colorBuffer) {
-					if (_colorBuffer[buffer_index]&buffer_bit_mask) {
-						_colorBuffer[buffer_index] &= ~(buffer_bit_mask); 
-						_blackBuffer[buffer_index] |= buffer_bit_mask;
-						break;
-					}
-				}
-				if (_blackBuffer[buffer_index]&buffer_bit_mask) {
-					_blackBuffer[buffer_index] &= ~(buffer_bit_mask); 
-				}
-				else {
-					if (_colorBuffer) {
-						_colorBuffer[buffer_index] |= buffer_bit_mask;
-					}
-					else {
-						_blackBuffer[buffer_index] |= buffer_bit_mask;
-					}
-				}
-				break;
-			default:
-				// what color is this?
-				break;			
-		}
-	}		
-	yield();
-}
-
-void ePaperCanvas::getBitSettingsForColor(uint16_t color, bool& blackBit, bool& colorBit )
-{
-	blackBit = false;
-	colorBit = false;
-	
-	switch (color) {
-		case ePaper_WHITE:
+	switch (_mode) {
+		case CMODE_3COLOR:
+			drawPixelInMode<CMODE_3COLOR>(x, y, color);
 			break;
-		case ePaper_BLACK:
-			blackBit = true;
-			if (getColorMode() == CMODE_4GRAY) {
-				colorBit = true;
-			}
+		case CMODE_4GRAY:
+			drawPixelInMode<CMODE_4GRAY>(x, y, color);
 			break;
-		case ePaper_COLOR:
-			if (getColorMode() == CMODE_3COLOR) {
-				colorBit = true;
-			}
+		default:
+			drawPixelInMode<CMODE_BW>(x, y, color);
 			break;
-		case ePaper_GRAY1:
-			if (getColorMode() == CMODE_4GRAY) {
-				blackBit = false;
-				colorBit = true;
-			}
+	}
+}
+
+void ePaperCanvas::rotateToBuffer(int16_t& x, int16_t& y) const
+{
+	switch(bufferRotation()) {
+		case 1:
+			swap_coordinates(x, y);
+			x = WIDTH - x - 1;
 			break;
-		case ePaper_GRAY2:
-			if (getColorMode() == CMODE_4GRAY) {
-				blackBit = true;
-				colorBit = false;
-			}
+		case 2:
+			x = WIDTH  - x - 1;
+			y = HEIGHT - y - 1;
 			break;
-		default:
-			// this method really should be called for other colors
+		case 3:
+			swap_coordinates(x, y);
+			y = HEIGHT - y - 1;
 			break;
 	}
 }
+
+/*!
+    @brief  Sets the rotation, see Adafruit_GFX::setRotation().
+    @param	r	the rotation, 0 to 3 in quarter turns clockwise.
+    @return None (void).
+    @note   With ROTATE_ON_SEND, a rotation that changes the image buffer layout clears
+    		the canvas to white.
+*/
+void ePaperCanvas::setRotation(uint8_t r)
+{
+	Adafruit_GFX::setRotation(r);
+	updateBufferLayout();
+}
+
+/*!
+    @brief  Sets how the rotation is applied to the image.
+    @param	mode	ROTATE_ON_DRAW to rotate each pixel into the device's layout as it is
+    				drawn, which is the default. ROTATE_ON_SEND to store the pixels as 
+    				drawn and rotate the planes as they are sent to the device, so that
+    				drawing on a rotated screen costs the same as on an unrotated one.
+    @return None (void).
+    @note   Changing the image buffer layout clears the canvas to white. With 
+    		ROTATE_ON_SEND on a rotated screen the planes are read a device byte at a 
+    		time while being sent, without asynchronous transfers.
+*/
+void ePaperCanvas::setRotationMode(ePaperRotationMode mode)
+{
+	_rotationMode = mode;
+	updateBufferLayout();
+}
+
+void ePaperCanvas::updateBufferLayout(void)
+{
+	uint8_t sendRotation = (_rotationMode == ROTATE_ON_SEND) ? getRotation() : 0;
+	if (sendRotation == _sendRotation) {
+		return;
+	}
+	_sendRotation = sendRotation;
+	_bufferWidth = (sendRotation&1) ? HEIGHT : WIDTH;
+	_bufferHeight = (sendRotation&1) ? WIDTH : HEIGHT;
+	_rowBytes = (_bufferWidth + 7)/8;
+
+	// the buffers hold the prior layout's image. a column of the 90 and 270 degree 
+	// layouts is (HEIGHT+7)/8 bytes, so the buffer size fits all of them.
+	if (_blackBuffer) {
+		memset(_blackBuffer, 0, _bufferSize);
+	}
+	if (_colorBuffer) {
+		memset(_colorBuffer, 0, _bufferSize);
+	}
+	clearDirtyRect();
+	markAllDirty();
+	markPlanesModified();
+}
+
+/*!
+    @brief  Sets every byte of a plane, skipping the leading bytes that already have 
+    		the value.
+    @return true if the plane changed.
+*/
+static bool fillPlane( uint8_t *plane, uint8_t value, uint32_t size )
+{
+	uint32_t i = 0;
+	while ((i < size)&&(plane[i] == value)) {
+		i++;
+	}
+	if (i == size) {
+		return false;
+	}
+	memset(&plane[i], value, size - i);
+	return true;
+}
+
 void ePaperCanvas::fillScreen(uint16_t color)
 {
 	uint8_t blackByte = 0;
@@ -253,10 +259,8 @@ void ePaperCanvas::fillScreen(uint16_t color)
 		case ePaper_COLOR:
 		case ePaper_GRAY1:
 		case ePaper_GRAY2:
-			bool blackBitOn, colorBitOn;
-			getBitSettingsForColor(color, blackBitOn, colorBitOn);
-			blackByte = blackBitOn ? 0xFF : 0x00;
-			colorByte = colorBitOn ? 0xFF : 0x00;
+			blackByte = colorBits(color).black;
+			colorByte = colorBits(color).color;
 			break;
 		default:
 		case ePaper_INVERSE1:
@@ -268,31 +272,117 @@ void ePaperCanvas::fillScreen(uint16_t color)
 	}
 
 	startWrite();
-	if (_blackBuffer) {
-		memset(_blackBuffer, blackByte, _bufferSize);
+	markAllDirty();
+	if (_blackBuffer && fillPlane(_blackBuffer, blackByte, _bufferSize)) {
+		_blackPlaneModified = true;
 	}
-	if (_colorBuffer) {
-		memset(_colorBuffer, colorByte, _bufferSize);
+	if (_colorBuffer && fillPlane(_colorBuffer, colorByte, _bufferSize)) {
+		_colorPlaneModified = true;
+	}
+	endWrite();
+}
+
+/*!
+    @brief  Sets whole bytes of each plane to a solid color.
+    @param	index	the first byte.
+    @param	count	the number of bytes.
+    @param	bits	the color's plane bits.
+    @return None (void).
+*/
+void ePaperCanvas::fillPlaneBytes(uint32_t index, uint32_t count, const ePaperColorBits& bits)
+{
+	if (fillPlane(&_blackBuffer[index], bits.black, count)) {
+		_blackPlaneModified = true;
+	}
+	if (_colorBuffer && fillPlane(&_colorBuffer[index], bits.color, count)) {
+		_colorPlaneModified = true;
+	}
+}
+
+/*!
+    @brief  Fills a rectangle with a solid color, a row of image buffer bytes at a time.
+    @param	x	left edge.
+    @param	y	top edge.
+    @param	w	width.
+    @param	h	height.
+    @param	color	the color.
+    @return None (void).
+    @note   The rectangle is clipped to the screen and converted to device coordinates
+    		once. Each row then has its partial edge bytes masked and the bytes between 
+    		them set whole, and rectangles spanning whole rows are set in one go. Inverse 
+    		colors are left to Adafruit_GFX.
+*/
+void ePaperCanvas::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+	if ((color == ePaper_INVERSE1)||(color == ePaper_INVERSE2)||(color == ePaper_INVERSE3)) {
+		Adafruit_GFX::fillRect(x, y, w, h, color);
+		return;
+	}
+	if (w < 0) {
+		x += w + 1;
+		w = -w;
+	}
+	if (h < 0) {
+		y += h + 1;
+		h = -h;
+	}
+	if (!mapToBufferRect(x, y, w, h)) {
+		return;
+	}
+
+	const ePaperColorBits& bits = colorBits((ePaperColorType)color);
+	markDirty(x, y, x + w - 1, y + h - 1);
+
+	uint32_t row_bytes = _rowBytes;
+	int16_t first_byte = x/8;
+	int16_t end_byte = (x + w - 1)/8 + 1;
+	uint8_t first_mask = 0xFF >> (x&7);
+	uint8_t last_mask = 0xFF << (7 - ((x + w - 1)&7));
+	if (end_byte - first_byte == 1) {
+		// both edges are in the same byte
+		first_mask &= last_mask;
+		last_mask = 0xFF;
+	}
+	int16_t whole_start = (first_mask == 0xFF) ? first_byte : first_byte + 1;
+	int16_t whole_end = (last_mask == 0xFF) ? end_byte : end_byte - 1;
+
+	startWrite();
+	if ((whole_start == 0)&&(whole_end == (int16_t)row_bytes)) {
+		fillPlaneBytes((uint32_t)y*row_bytes, (uint32_t)h*row_bytes, bits);
+	} else {
+		for (int16_t row = y; row < y + h; row++) {
+			uint32_t row_index = (uint32_t)row*row_bytes;
+			if (first_mask != 0xFF) {
+				writePlaneBits(row_index + first_byte, first_mask, bits);
+			}
+			if (whole_end > whole_start) {
+				fillPlaneBytes(row_index + whole_start, whole_end - whole_start, bits);
+			}
+			if (last_mask != 0xFF) {
+				writePlaneBits(row_index + end_byte - 1, last_mask, bits);
+			}
+			ePaperYield::yieldIfDue();
+		}
 	}
 	endWrite();
 }
 
 void ePaperCanvas::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
-	if (getRotation() == 0) {
+	if (bufferRotation() == 0) {
 		drawFastRawVLine(x, y, h, (ePaperColorType)color);
-	} else if (getRotation() == 1) {
+	} else if (bufferRotation() == 1) {
 		int16_t t = x;
 		x = WIDTH - 1 - y;
 		y = t;
 		x -= h - 1;
 		drawFastRawHLine(x, y, h, (ePaperColorType)color);
-	} else if (getRotation() == 2) {
+	} else if (bufferRotation() == 2) {
 		x = WIDTH - 1 - x;
       	y = HEIGHT - 1 - y;
       	
       	y -= h - 1;
       	drawFastRawVLine(x, y, h, (ePaperColorType)color);
-	} else if (getRotation() == 3) {
+	} else if (bufferRotation() == 3) {
 		int16_t t = x;
 		x = y;
 		y = HEIGHT - 1 - t;
@@ -319,20 +409,20 @@ void ePaperCanvas::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color
 		}
 	}
 
-	if (getRotation() == 0) {
+	if (bufferRotation() == 0) {
 		drawFastRawHLine(x, y, w, (ePaperColorType)color);
-	} else if (getRotation() == 1) {
+	} else if (bufferRotation() == 1) {
 		int16_t t = x;
 		x = WIDTH - 1 - y;
 		y = t;
 		drawFastRawVLine(x, y, w, (ePaperColorType)color);
-	} else if (getRotation() == 2) {
+	} else if (bufferRotation() == 2) {
 		x = WIDTH - 1 - x;
       	y = HEIGHT - 1 - y;
       	
       	x -= w - 1;
       	drawFastRawHLine(x, y, w, (ePaperColorType)color);
-	} else if (getRotation() == 3) {
+	} else if (bufferRotation() == 3) {
 		int16_t t = x;
 		x = y;
 		y = HEIGHT - 1 - t;
@@ -350,19 +440,20 @@ void ePaperCanvas::drawFastRawVLine(int16_t x, int16_t y, int16_t h, ePaperColor
 	}
 	
 	// first determine bit settings for color:
-	bool blackBitOn, colorBitOn;
-	getBitSettingsForColor(color, blackBitOn, colorBitOn);
+	const ePaperColorBits& bits = colorBits(color);
 	
 	// calculate start bye and subbit
-	uint32_t start_bit_index = (uint32_t)y*WIDTH + x;
+	uint32_t start_bit_index = (uint32_t)y*_rowBytes*8 + x;
 	uint32_t start_buffer_index = start_bit_index/8;
 	int8_t start_sub_bit = ((7-start_bit_index)&7);
 
 	// calculate bit mask
 	uint8_t byte_bit_mask = ePaperCanvas::bitmasks[start_sub_bit];
 
+	markDirty(x, y, x, y + h - 1);
+
 	// repeatedly apply the bit mask for each row
-	uint32_t row_bytes = WIDTH/8;
+	uint32_t row_bytes = _rowBytes;
 	for (int16_t i = 0; i < h; i++) {
 		uint32_t buffer_index = start_buffer_index + i*row_bytes;
 		
@@ -384,20 +475,8 @@ void ePaperCanvas::drawFastRawVLine(int16_t x, int16_t y, int16_t h, ePaperColor
 			return;
 		}
 		
-		if (blackBitOn) {
-			_blackBuffer[buffer_index] |= byte_bit_mask;
-		} else {
-			_blackBuffer[buffer_index] &= (~byte_bit_mask);
-		}
-	
-		if (_colorBuffer) {
-			if (colorBitOn) {
-				_colorBuffer[buffer_index] |= byte_bit_mask;
-			} else {
-				_colorBuffer[buffer_index] &= (~byte_bit_mask);
-			}
-		}
-		yield();
+		writePlaneBits(buffer_index, byte_bit_mask, bits);
+		ePaperYield::yieldIfDue();
 	}
 }
 
@@ -409,14 +488,14 @@ void ePaperCanvas::drawFastRawHLine(int16_t x, int16_t y, int16_t w, ePaperColor
 	}
 		
 	// first determine bit settings for color:
-	bool blackBitOn, colorBitOn;
-	getBitSettingsForColor(color, blackBitOn, colorBitOn);
+	const ePaperColorBits& bits = colorBits(color);
 
 	// calculate start bye and subbit
-	uint32_t start_bit_index = (y*WIDTH + x);
+	uint32_t start_bit_index = (uint32_t)y*_rowBytes*8 + x;
 	uint32_t remainingWidthBits = w;
 	uint32_t start_buffer_index = start_bit_index/8;
 	
+	markDirty(x, y, x + w - 1, y);
 	if (start_buffer_index >= _bufferSize) {
 		DEBUG_PRINT(F("WARNING - Start buffer index exceeded buffer size in ePaperCanvas::drawFastRawHLine(). x = "));
 		DEBUG_PRINT(x);
@@ -445,20 +524,7 @@ void ePaperCanvas::drawFastRawHLine(int16_t x, int16_t y, int16_t w, ePaperColor
 		}
 	
 		// set the start byte 
-	
-		if (blackBitOn) {
-			_blackBuffer[start_buffer_index] |= start_byte_bit_mask;
-		} else {
-			_blackBuffer[start_buffer_index] &= (~start_byte_bit_mask);
-		}
-	
-		if (_colorBuffer) {
-			if (colorBitOn) {
-				_colorBuffer[start_buffer_index] |= start_byte_bit_mask;
-			} else {
-				_colorBuffer[start_buffer_index] &= (~start_byte_bit_mask);
-			}
-		}
+		writePlaneBits(start_buffer_index, start_byte_bit_mask, bits);
 		start_buffer_index++;
 	}
 	
@@ -466,9 +532,6 @@ void ePaperCanvas::drawFastRawHLine(int16_t x, int16_t y, int16_t w, ePaperColor
 	if (remainingWidthBits > 0 ) {
 		uint32_t remainingWholeBytes = remainingWidthBits/8;
 		uint32_t lastByteBits = remainingWidthBits%8;
-
-		uint8_t blackByte = blackBitOn ? 0xFF : 0x00;
-		uint8_t colorByte = colorBitOn ? 0xFF : 0x00;
 	
 		// set the remaining whole bytes
 		for (uint32_t i = start_buffer_index;
@@ -491,11 +554,8 @@ void ePaperCanvas::drawFastRawHLine(int16_t x, int16_t y, int16_t w, ePaperColor
 				return;
 			}
 		
-			_blackBuffer[i] = blackByte;
-			if (_colorBuffer) {
-				_colorBuffer[i] = colorByte;
-			}
-			yield();
+			writePlaneBits(i, 0xFF, bits);
+			ePaperYield::yieldIfDue();
 		}
 		
 		// set the last byte's left bits
@@ -518,22 +578,222 @@ void ePaperCanvas::drawFastRawHLine(int16_t x, int16_t y, int16_t w, ePaperColor
 
 
 			uint8_t last_byte_bit_mask = 0x00;
-			for (int8_t i = 7; i >= 7-(int8_t)lastByteBits; i--) {
+			for (int8_t i = 7; i > 7-(int8_t)lastByteBits; i--) {
 				last_byte_bit_mask |= ePaperCanvas::bitmasks[i];
 			}
-			if (blackBitOn) {
-				_blackBuffer[start_buffer_index + remainingWholeBytes] |= last_byte_bit_mask;
-			} else {
-				_blackBuffer[start_buffer_index + remainingWholeBytes] &= (~last_byte_bit_mask);
+			uint32_t last_buffer_index = start_buffer_index + remainingWholeBytes;
+			writePlaneBits(last_buffer_index, last_byte_bit_mask, bits);
+		}
+	}
+}
+
+/*!
+    @brief  Clips a rectangle in the current rotation to the screen.
+    @return false if nothing of the rectangle is on screen.
+*/
+bool ePaperCanvas::clipToScreen(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const
+{
+	if (x < 0) {
+		w += x;
+		x = 0;
+	}
+	if (y < 0) {
+		h += y;
+		y = 0;
+	}
+	if (x + w > width()) {
+		w = width() - x;
+	}
+	if (y + h > height()) {
+		h = height() - y;
+	}
+	return (w > 0)&&(h > 0);
+}
+
+/*!
+    @brief  Converts an on screen rectangle in a rotation to the device's unrotated 
+    		coordinates.
+    @param	x, y, w, h	the rectangle, replaced with the rectangle on the device.
+    @param	rotation	the rotation the rectangle is in.
+    @return None (void).
+*/
+void ePaperCanvas::rotateRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h, uint8_t rotation) const
+{
+	int16_t t;
+	switch (rotation) {
+		case 1:
+			t = x;
+			x = WIDTH - y - h;
+			y = t;
+			t = w;
+			w = h;
+			h = t;
+			break;
+		case 2:
+			x = WIDTH - x - w;
+			y = HEIGHT - y - h;
+			break;
+		case 3:
+			t = x;
+			x = y;
+			y = HEIGHT - t - w;
+			t = w;
+			w = h;
+			h = t;
+			break;
+		default:
+			break;
+	}
+}
+
+/*!
+    @brief  Converts a rectangle in the current rotation to the device's unrotated 
+    		coordinates, clipping it to the screen.
+    @param	x	left edge. replaced with the left edge on the device.
+    @param	y	top edge. replaced with the top edge on the device.
+    @param	w	width. replaced with the width on the device.
+    @param	h	height. replaced with the height on the device.
+    @return false if nothing of the rectangle is on screen.
+*/
+bool ePaperCanvas::mapToDeviceRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const
+{
+	if (!clipToScreen(x, y, w, h)) {
+		return false;
+	}
+	rotateRect(x, y, w, h, getRotation());
+	return true;
+}
+
+/*!
+    @brief  Converts a rectangle in the current rotation to image buffer coordinates,
+    		clipping it to the screen, see mapToDeviceRect().
+*/
+bool ePaperCanvas::mapToBufferRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const
+{
+	if (!clipToScreen(x, y, w, h)) {
+		return false;
+	}
+	rotateRect(x, y, w, h, bufferRotation());
+	return true;
+}
+
+/*!
+    @brief  Gets the area of the image buffer changed since the last clearDirtyRect().
+    @param	x	set to the left edge, a multiple of 8.
+    @param	y	set to the top edge.
+    @param	w	set to the width, a multiple of 8.
+    @param	h	set to the height.
+    @return false if nothing has changed, in which case the parameters are not set.
+    @note   The rectangle is in the device's unrotated coordinates, regardless of
+    		the rotation that has been set.
+*/
+bool ePaperCanvas::getDirtyRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const
+{
+	if (!isDirty()) {
+		return false;
+	}
+	// the raw line drawing methods do not clip, so the box can run off screen
+	int16_t x0 = _dirtyX0 < 0 ? 0 : _dirtyX0;
+	int16_t y0 = _dirtyY0 < 0 ? 0 : _dirtyY0;
+	int16_t x1 = _dirtyX1 >= _bufferWidth ? _bufferWidth - 1 : _dirtyX1;
+	int16_t y1 = _dirtyY1 >= _bufferHeight ? _bufferHeight - 1 : _dirtyY1;
+	if ((x0 > x1)||(y0 > y1)) {
+		return false;
+	}
+	x = x0;
+	y = y0;
+	w = x1 - x0 + 1;
+	h = y1 - y0 + 1;
+	if (_sendRotation != 0) {
+		// the buffers are in the screen's rotation. widen the device rectangle to whole
+		// bytes of the device rows.
+		rotateRect(x, y, w, h, _sendRotation);
+		w = ((x + w + 7) & ~7) - (x & ~7);
+		x &= ~7;
+	}
+	return true;
+}
+
+void ePaperCanvas::clearDirtyRect(void)
+{
+	_dirtyX0 = _bufferWidth;
+	_dirtyY0 = _bufferHeight;
+	_dirtyX1 = -1;
+	_dirtyY1 = -1;
+}
+
+void ePaperCanvas::clearPlaneModified(const uint8_t *plane)
+{
+	if (plane == _blackBuffer) {
+		_blackPlaneModified = false;
+	} else if (plane == _colorBuffer) {
+		_colorPlaneModified = false;
+	}
+}
+
+static uint32_t hashBufferWords( uint32_t hash, const uint8_t *buffer, uint32_t size )
+{
+	// canvas buffers come from malloc() and so are word aligned
+	const uint32_t *words = (const uint32_t *)buffer;
+	uint32_t wordCount = size/4;
+	for (uint32_t i = 0; i < wordCount; i++) {
+		hash = (hash ^ words[i])*16777619UL;
+	}
+	for (uint32_t i = wordCount*4; i < size; i++) {
+		hash = (hash ^ buffer[i])*16777619UL;
+	}
+	return hash;
+}
+
+/*!
+    @brief  Calculates a digest of the image buffers, for telling whether the image 
+    		has changed.
+    @return the digest.
+    @note   FNV-1a applied to 32 bit words rather than bytes, so that hashing the
+    		buffers costs little next to sending them to the device.
+*/
+uint32_t ePaperCanvas::getImageHash(void) const
+{
+	uint32_t hash = 2166136261UL;
+	if (_blackBuffer) {
+		hash = hashBufferWords(hash, _blackBuffer, _bufferSize);
+	}
+	if (_colorBuffer) {
+		hash = hashBufferWords(hash, _colorBuffer, _bufferSize);
+	}
+	return hash;
+}
+
+/*!
+    @brief  Checks whether the image buffer only has black and white pixels, in which
+    		case a black and white waveform can show it.
+    @return true if no pixel is color or gray.
+    @note   Scans the color plane a word at a time. For gray scale, black pixels set
+    		the bits of both planes, so the planes only differ where there is gray.
+*/
+bool ePaperCanvas::hasOnlyBlackAndWhite(void) const
+{
+	switch (_mode) {
+		case CMODE_3COLOR: {
+			// canvas buffers come from malloc() and so are word aligned
+			const uint32_t *words = (const uint32_t *)_colorBuffer;
+			uint32_t wordCount = _bufferSize/4;
+			for (uint32_t i = 0; i < wordCount; i++) {
+				if (words[i] != 0) {
+					return false;
+				}
 			}
-			if (_colorBuffer) {
-				if (colorBitOn) {
-					_colorBuffer[start_buffer_index + remainingWholeBytes] |= last_byte_bit_mask;
-				} else {
-					_colorBuffer[start_buffer_index + remainingWholeBytes] &= (~last_byte_bit_mask);
+			for (uint32_t i = wordCount*4; i < _bufferSize; i++) {
+				if (_colorBuffer[i] != 0) {
+					return false;
 				}
 			}
+			return true;
 		}
+		case CMODE_4GRAY:
+			return memcmp(_blackBuffer, _colorBuffer, _bufferSize) == 0;
+		default:
+			return true;
 	}
 }
 
@@ -546,6 +806,8 @@ void  ePaperCanvas::invertDisplay(boolean i)
 		uint8_t *tempPtr = _colorBuffer;
 		_colorBuffer = _blackBuffer;
 		_blackBuffer = tempPtr;
+		markAllDirty();
+		markPlanesModified();
 		endWrite();
 	} else {
 		fillScreen(ePaper_INVERSE1);
@@ -584,7 +846,9 @@ void ePaperCanvas::setDeviceImage(
     @param	colorBitMapIsProgMem	indicates whether the passed bitmap resides in PROGMEM or not.
     @return None (void).
     @note   Since this sets the image buffers directly, the bit map must be correctly sized
-    		for the device's demensions. Also, any rotation that has been set is ignored. 
+    		for the device's demensions. Also, any rotation that has been set is ignored,
+    		except with ROTATE_ON_SEND, where the bitmaps are laid out as the rotated 
+    		screen with rows of whole bytes.
 */
 void ePaperCanvas::setDeviceImage( 
 	const uint8_t* blackBitMap,
@@ -595,12 +859,14 @@ void ePaperCanvas::setDeviceImage(
 	bool colorBitMapIsProgMem
 )
 {
+	markAllDirty();
 	if (blackBitMap && _blackBuffer && (blackBitMapSize <= _bufferSize)) {
 		if (blackBitMapIsProgMem) {
 			memcpy_P(_blackBuffer, blackBitMap, blackBitMapSize);
 		} else {
 			memcpy(_blackBuffer, blackBitMap, blackBitMapSize);
 		}
+		_blackPlaneModified = true;
 	}
 	if (colorBitMap && _colorBuffer && (colorBitMapSize <= _bufferSize)) {
 		if (blackBitMapIsProgMem) {
@@ -608,10 +874,27 @@ void ePaperCanvas::setDeviceImage(
 		} else {
 			memcpy(_colorBuffer, colorBitMap, colorBitMapSize);
 		}
+		_colorPlaneModified = true;
 	}
 }
 
 
+/*!
+    @brief  Draws a bitmap image, black over white, with its color pixels on top.
+    @param	loc_x, loc_y	where the image's top left pixel goes.
+    @param	img_w, img_h	the image dimensions.
+    @param	blackBitMap		the black pixels, or null. The rows are packed one after 
+    						the other, high bit first.
+    @param	blackBitMapSize	the size of the black bitmap in total bytes.
+    @param	blackBitMapIsProgMem	indicates whether the black bitmap resides in PROGMEM.
+    @param	colorBitMap		the color pixels, or null. Laid out as the black bitmap.
+    @param	colorBitMapSize	the size of the color bitmap in total bytes.
+    @param	colorBitMapIsProgMem	indicates whether the color bitmap resides in PROGMEM.
+    @return None (void).
+    @note   For 4-level gray scale displays the two bitmaps are the image planes, and
+    		both are needed. Otherwise the black bitmap replaces the area's pixels and
+    		the color bitmap's set pixels are laid over them. Drawn with blitBitImage().
+*/
 void ePaperCanvas::drawBitImage( 
 	int16_t loc_x, int16_t loc_y,
 	int16_t img_w, int16_t img_h,
@@ -623,56 +906,751 @@ void ePaperCanvas::drawBitImage(
 	bool colorBitMapIsProgMem
 )
 {
+	if (getColorMode() == CMODE_4GRAY) {
+		if (blackBitMap && colorBitMap) {
+			blitBitImage(loc_x, loc_y, img_w, img_h, blackBitMap, blackBitMapSize, blackBitMapIsProgMem,
+							IMAGE_PLANE_BLACK, RASTER_OP_COPY);
+			blitBitImage(loc_x, loc_y, img_w, img_h, colorBitMap, colorBitMapSize, colorBitMapIsProgMem,
+							IMAGE_PLANE_COLOR, RASTER_OP_COPY);
+		}
+		return;
+	}
+	if (blackBitMap && (img_w > 0)) {
+		blitBitImage(loc_x, loc_y, img_w, img_h, blackBitMap, blackBitMapSize, blackBitMapIsProgMem,
+						IMAGE_PLANE_BLACK, RASTER_OP_COPY);
+		if (_colorBuffer) {
+			// the black image's pixels are black or white, never color
+			uint32_t rows = blackBitMapSize*8/img_w;
+			blitBitImage(loc_x, loc_y, img_w, (rows < (uint32_t)img_h) ? rows : img_h, nullptr, 0, false,
+							IMAGE_PLANE_COLOR, RASTER_OP_AND_NOT);
+		}
+	}
+	if (colorBitMap && _colorBuffer) {
+		blitBitImage(loc_x, loc_y, img_w, img_h, colorBitMap, colorBitMapSize, colorBitMapIsProgMem,
+						IMAGE_PLANE_COLOR, RASTER_OP_OVERLAY);
+	}
+}
 
-	for (int16_t i = 0; i < img_w; i++ ) {
-		for (int16_t j = 0; j < img_h; j++ ) {
-			uint32_t bit_index = (j*img_w + i);
-			uint32_t buffer_index = bit_index/8;
-			int8_t buffer_bit_mask = (1 << ((7-bit_index)&7));
-			
-			if (blackBitMap && colorBitMap && (getColorMode() == CMODE_4GRAY)) {
-				// in 4 gray mode need to interpret the bits
-				if( (buffer_index < blackBitMapSize)&&(buffer_index <= colorBitMapSize)) {
-					uint8_t blackByteVal = blackBitMapIsProgMem ? pgm_read_byte(&blackBitMap[buffer_index]) : blackBitMap[buffer_index];
-					uint8_t colorByteVal = colorBitMapIsProgMem ? pgm_read_byte(&colorBitMap[buffer_index]) : colorBitMap[buffer_index];
-					bool isBlack = blackByteVal&buffer_bit_mask ? true : false;
-					bool isColor = colorByteVal&buffer_bit_mask ? true : false;
-					ePaperColorType c = ePaper_BLACK;
-					if (isBlack&&isColor) {
-						// both on is black
-						c = ePaper_BLACK;
-					}
-					else if (isBlack && (!isColor)) {
-						c = ePaper_GRAY2;
-					}
-					else if ((!isBlack) && isColor) {
-						c = ePaper_GRAY1;
-					}
-					else if ((!isBlack) && (!isColor)) {
-						c = ePaper_WHITE;
-					}
-					
-					this->drawPixel(loc_x+i, loc_y+j, c);
+/*!
+    @brief  Combines a bitmap image with one image plane.
+    @param	loc_x, loc_y	where the image's top left pixel goes.
+    @param	img_w, img_h	the image dimensions.
+    @param	bitMap			the image, with its rows packed one after the other, high bit
+    						first. Null for an image with every bit set.
+    @param	bitMapSize		the size of the bitmap in total bytes. Rows the bitmap does not
+    						completely hold are not drawn.
+    @param	bitMapIsProgMem	indicates whether the bitmap resides in PROGMEM.
+    @param	plane			the plane to combine the image with.
+    @param	op				how the image's bits are combined with the plane's.
+    @return None (void).
+    @note   The image is clipped to the screen once. Without rotation, each row is
+    		shifted into place and combined with the plane a byte at a time. Rotated
+    		screens also write whole device bytes, see blitPlaneRotated().
+*/
+void ePaperCanvas::blitBitImage(
+	int16_t loc_x, int16_t loc_y,
+	int16_t img_w, int16_t img_h,
+	const uint8_t* bitMap,
+	uint32_t bitMapSize,
+	bool bitMapIsProgMem,
+	ePaperImagePlane plane,
+	ePaperRasterOp op
+)
+{
+	uint8_t *target = (plane == IMAGE_PLANE_COLOR) ? _colorBuffer : _blackBuffer;
+	uint8_t *other = (plane == IMAGE_PLANE_COLOR) ? _blackBuffer : _colorBuffer;
+	if ((target == nullptr)||(img_w <= 0)||(img_h <= 0)) {
+		return;
+	}
+	if (bitMap) {
+		uint32_t rows = bitMapSize*8/img_w;
+		if (rows < (uint32_t)img_h) {
+			img_h = rows;
+		}
+	}
+	
+	startWrite();
+	if (op == RASTER_OP_OVERLAY) {
+		if (other && blitPlane(other, loc_x, loc_y, img_w, img_h, bitMap, bitMapSize, bitMapIsProgMem, RASTER_OP_AND_NOT)) {
+			if (other == _blackBuffer) {
+				_blackPlaneModified = true;
+			} else {
+				_colorPlaneModified = true;
+			}
+		}
+		op = RASTER_OP_OR;
+	}
+	if (blitPlane(target, loc_x, loc_y, img_w, img_h, bitMap, bitMapSize, bitMapIsProgMem, op)) {
+		if (target == _blackBuffer) {
+			_blackPlaneModified = true;
+		} else {
+			_colorPlaneModified = true;
+		}
+	}
+	endWrite();
+}
+
+static inline uint8_t bitMapByte(const uint8_t *bitMap, int32_t index, uint32_t size, bool isProgMem)
+{
+	if ((index < 0)||((uint32_t)index >= size)) {
+		return 0;
+	}
+	return isProgMem ? pgm_read_byte(&bitMap[index]) : bitMap[index];
+}
+
+static inline uint8_t applyRasterOp(uint8_t dest, uint8_t source, uint8_t mask, ePaperRasterOp op)
+{
+	source &= mask;
+	switch (op) {
+		case RASTER_OP_OR:
+			return dest | source;
+		case RASTER_OP_AND_NOT:
+			return dest & ~source;
+		case RASTER_OP_XOR:
+			return dest ^ source;
+		default:
+			return (dest & ~mask) | source;
+	}
+}
+
+// the 8 bitmap bits starting at a bit offset, high bit first. bits before or after the
+// bitmap are 0, and a null bitmap has every bit set.
+static inline uint8_t bitMapBits(const uint8_t *bitMap, int32_t offset, uint32_t size, bool isProgMem)
+{
+	if (bitMap == nullptr) {
+		return 0xFF;
+	}
+	uint8_t shift = offset&7;
+	int32_t index = (offset - shift)/8;
+	uint8_t bits = bitMapByte(bitMap, index, size, isProgMem);
+	if (shift) {
+		bits = (bits << shift)|(bitMapByte(bitMap, index + 1, size, isProgMem) >> (8 - shift));
+	}
+	return bits;
+}
+
+static inline uint8_t reverseBits(uint8_t bits)
+{
+	bits = (bits >> 4)|(bits << 4);
+	bits = ((bits & 0xCC) >> 2)|((bits & 0x33) << 2);
+	bits = ((bits & 0xAA) >> 1)|((bits & 0x55) << 1);
+	return bits;
+}
+
+/*!
+    @brief  Transposes an 8x8 bit matrix, one byte per row with the high bit first, so
+    		that bit m of row k becomes bit k of row m.
+    @param	rows	the matrix, transposed in place.
+    @return None (void).
+    @note   The transpose8 kernel from Hacker's Delight, without branches.
+*/
+static void transposeBits(uint8_t rows[8])
+{
+	uint32_t x = ((uint32_t)rows[0] << 24)|((uint32_t)rows[1] << 16)|((uint32_t)rows[2] << 8)|rows[3];
+	uint32_t y = ((uint32_t)rows[4] << 24)|((uint32_t)rows[5] << 16)|((uint32_t)rows[6] << 8)|rows[7];
+	uint32_t t;
+
+	t = (x ^ (x >> 7)) & 0x00AA00AAUL;
+	x = x ^ t ^ (t << 7);
+	t = (y ^ (y >> 7)) & 0x00AA00AAUL;
+	y = y ^ t ^ (t << 7);
+
+	t = (x ^ (x >> 14)) & 0x0000CCCCUL;
+	x = x ^ t ^ (t << 14);
+	t = (y ^ (y >> 14)) & 0x0000CCCCUL;
+	y = y ^ t ^ (t << 14);
+
+	t = (x & 0xF0F0F0F0UL)|((y >> 4) & 0x0F0F0F0FUL);
+	y = ((x << 4) & 0xF0F0F0F0UL)|(y & 0x0F0F0F0FUL);
+	x = t;
+
+	rows[0] = x >> 24;
+	rows[1] = x >> 16;
+	rows[2] = x >> 8;
+	rows[3] = x;
+	rows[4] = y >> 24;
+	rows[5] = y >> 16;
+	rows[6] = y >> 8;
+	rows[7] = y;
+}
+
+/*!
+    @brief  Reads bytes of a row of an image plane as the device lays it out.
+    @param	plane	getBuffer1() or getBuffer2().
+    @param	row		the device row.
+    @param	byteX	the first byte of the row.
+    @param	count	the number of bytes.
+    @param	bytes	set to the bytes.
+    @return None (void).
+    @note   At 180 degrees a device row is an image buffer row read backwards with the
+    		bits of each byte reversed. At 90 and 270 degrees it is an image buffer column, 
+    		so each device byte is transposed out of 8 image buffer rows, see 
+    		getDeviceRows().
+*/
+void ePaperCanvas::getDeviceBytes(
+	const uint8_t *plane,
+	int16_t row,
+	int16_t byteX,
+	uint16_t count,
+	uint8_t *bytes
+) const
+{
+	switch (_sendRotation) {
+		case 2: {
+			const uint8_t *source = &plane[(uint32_t)(HEIGHT - 1 - row)*_rowBytes + _rowBytes - 1 - byteX];
+			for (uint16_t k = 0; k < count; k++) {
+				bytes[k] = reverseBits(*source--);
+			}
+			break;
+		}
+		case 1:
+		case 3:
+			getDeviceRows(plane, row, row, byteX, count, bytes);
+			break;
+		default:
+			memcpy(bytes, &plane[(uint32_t)row*_rowBytes + byteX], count);
+			break;
+	}
+}
+
+/*!
+    @brief  Reads bytes of as many device rows, up to 8, as can be read together.
+    @param	plane	getBuffer1() or getBuffer2().
+    @param	row		the first device row.
+    @param	lastRow	the last device row that may be read.
+    @param	byteX	the first byte of each row.
+    @param	count	the number of bytes of each row.
+    @param	bytes	set to the rows' bytes, one row after the other. Must have room for
+    				8 rows.
+    @return the number of rows read.
+    @note   At 90 and 270 degrees the device rows are image buffer columns, so the 8 
+    		device rows within one image buffer byte column are transposed out of the 
+    		same 8 image buffer bytes for each device byte, and are read together. 
+    		Otherwise one row is read.
+*/
+uint8_t ePaperCanvas::getDeviceRows(
+	const uint8_t *plane,
+	int16_t row,
+	int16_t lastRow,
+	int16_t byteX,
+	uint16_t count,
+	uint8_t *bytes
+) const
+{
+	if (!isTransposedOnSend()) {
+		getDeviceBytes(plane, row, byteX, count, bytes);
+		return 1;
+	}
+
+	// device pixel (x, row) is screen pixel (row, WIDTH-1-x) at 90 degrees and
+	// (HEIGHT-1-row, x) at 270 degrees
+	bool rotated90 = (_sendRotation == 1);
+	int16_t column = rotated90 ? row : HEIGHT - 1 - row;
+	int16_t rowCount = rotated90 ? 8 - (column&7) : (column&7) + 1;
+	if (rowCount > lastRow - row + 1) {
+		rowCount = lastRow - row + 1;
+	}
+	const uint8_t *source = &plane[column >> 3];
+	int32_t step = rotated90 ? -(int32_t)_rowBytes : (int32_t)_rowBytes;
+	for (uint16_t k = 0; k < count; k++) {
+		// the image buffer rows of the device byte's 8 pixels
+		int16_t x = 8*(byteX + k);
+		const uint8_t *pixelRow = &source[(int32_t)(rotated90 ? WIDTH - 1 - x : x)*_rowBytes];
+		uint8_t block[8];
+		for (uint8_t b = 0; b < 8; b++) {
+			block[b] = *pixelRow;
+			pixelRow += step;
+		}
+		transposeBits(block);
+
+		// block[m] is now the device byte for image buffer column 8*(column>>3)+m
+		for (int16_t i = 0; i < rowCount; i++) {
+			bytes[(uint32_t)i*count + k] = block[(rotated90 ? column + i : column - i)&7];
+		}
+	}
+	return rowCount;
+}
+
+/*!
+    @brief  Combines a bitmap image with a plane when the screen is rotated, see 
+    		blitPlane().
+    @param	x0, y0, x1, y1	the image's area on screen, in the current rotation. x1 and 
+    						y1 are exclusive.
+    @return true if any of the plane's bits changed.
+    @note   At 90 and 270 degrees each device byte holds a pixel from 8 image rows, so 
+    		the image is read in blocks of 8 rows by 8 columns that are transposed into
+    		8 device bytes. At 180 degrees the image rows are read backwards with the 
+    		bits of each byte reversed.
+*/
+bool ePaperCanvas::blitPlaneRotated(
+	uint8_t *plane,
+	int16_t loc_x, int16_t loc_y,
+	int16_t img_w,
+	int16_t x0, int16_t y0,
+	int16_t x1, int16_t y1,
+	const uint8_t* bitMap,
+	uint32_t bitMapSize,
+	bool bitMapIsProgMem,
+	ePaperRasterOp op
+)
+{
+	int16_t dev_x = x0;
+	int16_t dev_y = y0;
+	int16_t dev_w = x1 - x0;
+	int16_t dev_h = y1 - y0;
+	mapToBufferRect(dev_x, dev_y, dev_w, dev_h);
+	markDirty(dev_x, dev_y, dev_x + dev_w - 1, dev_y + dev_h - 1);
+
+	bool changed = false;
+	uint32_t row_bytes = WIDTH/8;
+	int16_t first_byte = dev_x/8;
+	int16_t last_byte = (dev_x + dev_w - 1)/8;
+	uint8_t first_mask = 0xFF >> (dev_x&7);
+	uint8_t last_mask = 0xFF << (7 - ((dev_x + dev_w - 1)&7));
+
+	if (bufferRotation() == 2) {
+		// image row j is device row HEIGHT-1-j, and image column i device column WIDTH-1-i
+		for (int16_t j = y0; j < y1; j++) {
+			int32_t row_bit = (int32_t)(j - loc_y)*img_w - loc_x;
+			uint8_t *dest = &plane[(uint32_t)(HEIGHT - 1 - j)*row_bytes + first_byte];
+			for (int16_t k = first_byte; k <= last_byte; k++, dest++) {
+				// the byte's pixels are image columns WIDTH-1-8k down to WIDTH-8-8k
+				uint8_t source = reverseBits(bitMapBits(bitMap, row_bit + WIDTH - 8 - 8*k, bitMapSize, bitMapIsProgMem));
+				uint8_t mask = 0xFF;
+				if (k == first_byte) {
+					mask &= first_mask;
 				}
-				
+				if (k == last_byte) {
+					mask &= last_mask;
+				}
+				uint8_t prior = *dest;
+				*dest = applyRasterOp(prior, source, mask, op);
+				changed |= (*dest != prior);
+			}
+			ePaperYield::yieldIfDue();
+		}
+		return changed;
+	}
+
+	// at 90 degrees image row j is device column WIDTH-1-j and image column i device row
+	// i. at 270 degrees image row j is device column j and image column i device row
+	// HEIGHT-1-i.
+	bool rotated90 = (bufferRotation() == 1);
+	for (int16_t k = first_byte; k <= last_byte; k++) {
+		uint8_t mask = 0xFF;
+		if (k == first_byte) {
+			mask &= first_mask;
+		}
+		if (k == last_byte) {
+			mask &= last_mask;
+		}
+		for (int16_t i0 = x0; i0 < x1; i0 += 8) {
+			// one image row per device column of the byte, for image columns i0 to i0+7
+			uint8_t block[8];
+			for (uint8_t b = 0; b < 8; b++) {
+				int16_t dev_col = 8*k + b;
+				int16_t j = rotated90 ? WIDTH - 1 - dev_col : dev_col;
+				block[b] = (mask & (0x80 >> b)) 
+							? bitMapBits(bitMap, (int32_t)(j - loc_y)*img_w + (i0 - loc_x), bitMapSize, bitMapIsProgMem)
+							: 0;
 			}
-			else if (getColorMode() != CMODE_4GRAY) {
-				// use B&W or 3 Color mode
-				if (blackBitMap && _blackBuffer && (buffer_index < blackBitMapSize)) {
-					uint8_t byteVal = blackBitMapIsProgMem ? pgm_read_byte(&blackBitMap[buffer_index]) : blackBitMap[buffer_index];
-					bool isBlack = byteVal&buffer_bit_mask ? true : false;
-					this->drawPixel(loc_x+i, loc_y+j, isBlack ? ePaper_BLACK : ePaper_WHITE );
+			transposeBits(block);
+
+			// block[m] is now the device byte for image column i0+m
+			int16_t columns = (x1 - i0 < 8) ? x1 - i0 : 8;
+			for (int16_t m = 0; m < columns; m++) {
+				int16_t dev_row = rotated90 ? i0 + m : HEIGHT - 1 - (i0 + m);
+				uint8_t *dest = &plane[(uint32_t)dev_row*row_bytes + k];
+				uint8_t prior = *dest;
+				*dest = applyRasterOp(prior, block[m], mask, op);
+				changed |= (*dest != prior);
+			}
+		}
+		ePaperYield::yieldIfDue();
+	}
+	return changed;
+}
+
+/*!
+    @brief  Combines a bitmap image with a plane, see blitBitImage().
+    @return true if any of the plane's bits changed.
+*/
+bool ePaperCanvas::blitPlane(
+	uint8_t *plane,
+	int16_t loc_x, int16_t loc_y,
+	int16_t img_w, int16_t img_h,
+	const uint8_t* bitMap,
+	uint32_t bitMapSize,
+	bool bitMapIsProgMem,
+	ePaperRasterOp op
+)
+{
+	// clip to the screen, in the current rotation
+	int16_t x0 = (loc_x < 0) ? 0 : loc_x;
+	int16_t y0 = (loc_y < 0) ? 0 : loc_y;
+	int16_t x1 = (loc_x + img_w > width()) ? width() : loc_x + img_w;
+	int16_t y1 = (loc_y + img_h > height()) ? height() : loc_y + img_h;
+	if ((x0 >= x1)||(y0 >= y1)) {
+		return false;
+	}
+
+	if (bufferRotation() != 0) {
+		return blitPlaneRotated(plane, loc_x, loc_y, img_w, x0, y0, x1, y1,
+								bitMap, bitMapSize, bitMapIsProgMem, op);
+	}
+
+	bool changed = false;
+	markDirty(x0, y0, x1 - 1, y1 - 1);
+
+	uint32_t row_bytes = _rowBytes;
+	int16_t first_byte = x0/8;
+	int16_t last_byte = (x1 - 1)/8;
+	uint8_t first_mask = 0xFF >> (x0&7);
+	uint8_t last_mask = 0xFF << (7 - ((x1 - 1)&7));
+	for (int16_t j = y0; j < y1; j++) {
+		// the image bit that lands on the high bit of the row's first byte, which can be
+		// before the image when the image is not byte aligned on the screen
+		int32_t src_bit = (int32_t)(j - loc_y)*img_w + (x0 - loc_x) - (x0&7);
+		uint8_t shift = src_bit&7;
+		int32_t src_index = (src_bit - shift)/8;
+		uint8_t high = bitMap ? bitMapByte(bitMap, src_index, bitMapSize, bitMapIsProgMem) : 0xFF;
+		uint8_t *dest = &plane[(uint32_t)j*row_bytes + first_byte];
+
+		for (int16_t k = first_byte; k <= last_byte; k++, dest++) {
+			uint8_t source = 0xFF;
+			if (bitMap) {
+				uint8_t low = bitMapByte(bitMap, ++src_index, bitMapSize, bitMapIsProgMem);
+				source = shift ? (uint8_t)((high << shift)|(low >> (8 - shift))) : high;
+				high = low;
+			}
+			uint8_t mask = 0xFF;
+			if (k == first_byte) {
+				mask &= first_mask;
+			}
+			if (k == last_byte) {
+				mask &= last_mask;
+			}
+			uint8_t prior = *dest;
+			*dest = applyRasterOp(prior, source, mask, op);
+			changed |= (*dest != prior);
+		}
+		ePaperYield::yieldIfDue();
+	}
+	return changed;
+}
+
+//
+// Text
+//
+
+// the font structures are in PROGMEM on AVR. elsewhere they can be read directly.
+static const GFXglyph *fontGlyph(const GFXfont *font, uint8_t index)
+{
+#ifdef __AVR__
+	return &((const GFXglyph *)pgm_read_word(&font->glyph))[index];
+#else
+	return font->glyph + index;
+#endif
+}
+
+static const uint8_t *fontBitmap(const GFXfont *font)
+{
+#ifdef __AVR__
+	return (const uint8_t *)pgm_read_word(&font->bitmap);
+#else
+	return font->bitmap;
+#endif
+}
+
+/*!
+    @brief  Writes a character at the text cursor and advances the cursor, as
+    		Adafruit_GFX::write() does.
+    @param	c	the character.
+    @return 1, the number of characters written.
+    @note   Adafruit_GFX::write() calls its own drawChar(), so text in a GFXfont font
+    		is handled here to reach the canvas' drawChar(). The built in font is 
+    		left to Adafruit_GFX.
+*/
+size_t ePaperCanvas::write(uint8_t c)
+{
+	if (gfxFont == nullptr) {
+		return Adafruit_GFX::write(c);
+	}
+	uint8_t yAdvance = pgm_read_byte(&gfxFont->yAdvance);
+	if (c == '\n') {
+		cursor_x = 0;
+		cursor_y += (int16_t)textsize_y*yAdvance;
+	} else if (c != '\r') {
+		uint8_t first = pgm_read_word(&gfxFont->first);
+		if ((c >= first)&&(c <= (uint8_t)pgm_read_word(&gfxFont->last))) {
+			const GFXglyph *glyph = fontGlyph(gfxFont, c - first);
+			uint8_t w = pgm_read_byte(&glyph->width);
+			uint8_t h = pgm_read_byte(&glyph->height);
+			if ((w > 0)&&(h > 0)) {
+				int16_t xo = (int8_t)pgm_read_byte(&glyph->xOffset);
+				if (wrap && ((cursor_x + textsize_x*(xo + w)) > _width)) {
+					cursor_x = 0;
+					cursor_y += (int16_t)textsize_y*yAdvance;
+				}
+				drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize_x, textsize_y);
+			}
+			cursor_x += (uint8_t)pgm_read_byte(&glyph->xAdvance)*(int16_t)textsize_x;
+		}
+	}
+	return 1;
+}
+
+/*!
+    @brief  Draws a character, see Adafruit_GFX::drawChar().
+    @param	x, y	the character's origin, which for GFXfont fonts is on the baseline.
+    @param	c		the character.
+    @param	color	the text color.
+    @param	bg		the background color, used by the built in font only.
+    @param	size_x, size_y	the horizontal and vertical scale.
+    @return None (void).
+*/
+void ePaperCanvas::drawChar(
+	int16_t x, int16_t y,
+	unsigned char c,
+	uint16_t color,
+	uint16_t bg,
+	uint8_t size_x, uint8_t size_y
+)
+{
+	if ((gfxFont == nullptr)||!drawFontGlyph(x, y, c, color, size_x, size_y)) {
+		Adafruit_GFX::drawChar(x, y, c, color, bg, size_x, size_y);
+	}
+}
+
+/*!
+    @brief  Draws the set pixels of a bitmap image in a solid color, leaving the others
+    		unchanged.
+    @param	bits	the color's plane bits.
+    @note   One blitBitImage() per plane, setting the plane's bits under the image for
+    		colors having them and clearing them for the others.
+*/
+void ePaperCanvas::blitSolidImage(
+	int16_t loc_x, int16_t loc_y,
+	int16_t img_w, int16_t img_h,
+	const uint8_t* bitMap,
+	uint32_t bitMapSize,
+	bool bitMapIsProgMem,
+	const ePaperColorBits& bits
+)
+{
+	blitBitImage(loc_x, loc_y, img_w, img_h, bitMap, bitMapSize, bitMapIsProgMem,
+					IMAGE_PLANE_BLACK, bits.black ? RASTER_OP_OR : RASTER_OP_AND_NOT);
+	if (_colorBuffer) {
+		blitBitImage(loc_x, loc_y, img_w, img_h, bitMap, bitMapSize, bitMapIsProgMem,
+						IMAGE_PLANE_COLOR, bits.color ? RASTER_OP_OR : RASTER_OP_AND_NOT);
+	}
+}
+
+/*!
+    @brief  Draws a glyph of the current GFXfont font in a solid color.
+    @return false if the glyph needs drawing by Adafruit_GFX instead, which is for 
+    		inverse colors and characters the font does not have.
+    @note   Glyph bitmaps have their rows packed one after the other, high bit first,
+    		so an unscaled glyph is blitted directly from the font. Scaled glyphs have
+    		each horizontal run of set bits filled as one rectangle, rather than a
+    		rectangle per pixel.
+*/
+bool ePaperCanvas::drawFontGlyph(
+	int16_t x, int16_t y,
+	unsigned char c,
+	uint16_t color,
+	uint8_t size_x, uint8_t size_y
+)
+{
+	if ((color == ePaper_INVERSE1)||(color == ePaper_INVERSE2)||(color == ePaper_INVERSE3)) {
+		return false;
+	}
+	uint8_t first = pgm_read_word(&gfxFont->first);
+	if ((c < first)||(c > pgm_read_word(&gfxFont->last))) {
+		return false;
+	}
+	const GFXglyph *glyph = fontGlyph(gfxFont, c - first);
+	const uint8_t *bitmap = fontBitmap(gfxFont) + pgm_read_word(&glyph->bitmapOffset);
+	int16_t w = pgm_read_byte(&glyph->width);
+	int16_t h = pgm_read_byte(&glyph->height);
+	int16_t xo = (int8_t)pgm_read_byte(&glyph->xOffset);
+	int16_t yo = (int8_t)pgm_read_byte(&glyph->yOffset);
+	const ePaperColorBits& bits = colorBits((ePaperColorType)color);
+
+	if ((size_x == 1)&&(size_y == 1)) {
+		// drawPixel() leaves the pixels of colors the mode does not have unchanged
+		if ((w > 0)&&(h > 0)&&bits.write) {
+			blitSolidImage(x + xo, y + yo, w, h, bitmap, ((uint32_t)w*h + 7)/8, true, bits);
+		}
+		return true;
+	}
+	if ((w == 0)||(h == 0)||(size_x == 0)||(size_y == 0)) {
+		return true;
+	}
+
+	if (_textCache) {
+		ePaperTextCache::Entry *entry = cachedTextImage(&c, 1, size_x, size_y);
+		if (entry) {
+			blitSolidImage(x + entry->offsetX, y + entry->offsetY, entry->width, entry->height,
+							entry->image(), entry->imageSize(), false, bits);
+			return true;
+		}
+	}
+
+	// each run of set bits in a glyph row is one rectangle
+	uint16_t bit = 0;
+	startWrite();
+	for (int16_t yy = 0; yy < h; yy++) {
+		int16_t run_start = -1;
+		for (int16_t xx = 0; xx < w; xx++, bit++) {
+			if (pgm_read_byte(&bitmap[bit >> 3]) & (0x80 >> (bit&7))) {
+				if (run_start < 0) {
+					run_start = xx;
 				}
-				if (colorBitMap && _colorBuffer && (buffer_index <= colorBitMapSize)) {
-					uint8_t byteVal = colorBitMapIsProgMem ? pgm_read_byte(&colorBitMap[buffer_index]) : colorBitMap[buffer_index];
-					bool isColor = byteVal&buffer_bit_mask ? true : false;
-					// only set red, let B&W image be the "background"
-					if (isColor) {
-						this->drawPixel(loc_x+i, loc_y+j, ePaper_COLOR);
+			} else if (run_start >= 0) {
+				fillRect(x + (xo + run_start)*size_x, y + (yo + yy)*size_y, (xx - run_start)*size_x, size_y, color);
+				run_start = -1;
+			}
+		}
+		if (run_start >= 0) {
+			fillRect(x + (xo + run_start)*size_x, y + (yo + yy)*size_y, (w - run_start)*size_x, size_y, color);
+		}
+	}
+	endWrite();
+	return true;
+}
+
+// sets count bits of an image from a bit offset, high bit first
+static void setBitRun(uint8_t *image, uint32_t offset, uint16_t count)
+{
+	while (count > 0) {
+		uint8_t shift = offset&7;
+		uint8_t run = (count < 8 - shift) ? count : 8 - shift;
+		image[offset >> 3] |= (uint8_t)(0xFF << (8 - run)) >> shift;
+		offset += run;
+		count -= run;
+	}
+}
+
+/*!
+    @brief  Gets the image of some text in the current font from the text cache, 
+    		rasterizing it into the cache if it is not there.
+    @param	text	the characters, which are placed as write() places them, without
+    				wrapping. Characters the font does not have are skipped.
+    @param	length	the number of characters.
+    @param	size_x, size_y	the text size.
+    @return the cache entry, or null if the image does not fit in the cache.
+*/
+ePaperTextCache::Entry *ePaperCanvas::cachedTextImage(
+	const uint8_t *text,
+	uint16_t length,
+	uint8_t size_x, uint8_t size_y
+)
+{
+	ePaperTextCache::Entry *entry = _textCache->find(gfxFont, size_x, size_y, text, length);
+	if (entry) {
+		return entry;
+	}
+	uint8_t first = pgm_read_word(&gfxFont->first);
+	uint8_t last = pgm_read_word(&gfxFont->last);
+
+	// the bounding box of the glyphs, relative to the text cursor
+	int16_t x0 = INT16_MAX;
+	int16_t y0 = INT16_MAX;
+	int16_t x1 = INT16_MIN;
+	int16_t y1 = INT16_MIN;
+	int16_t cursor = 0;
+	for (uint16_t i = 0; i < length; i++) {
+		if ((text[i] < first)||(text[i] > last)) {
+			continue;
+		}
+		const GFXglyph *glyph = fontGlyph(gfxFont, text[i] - first);
+		int16_t w = pgm_read_byte(&glyph->width);
+		int16_t h = pgm_read_byte(&glyph->height);
+		if ((w > 0)&&(h > 0)) {
+			int16_t gx = cursor + (int8_t)pgm_read_byte(&glyph->xOffset)*size_x;
+			int16_t gy = (int8_t)pgm_read_byte(&glyph->yOffset)*size_y;
+			if (gx < x0) x0 = gx;
+			if (gy < y0) y0 = gy;
+			if (gx + w*size_x > x1) x1 = gx + w*size_x;
+			if (gy + h*size_y > y1) y1 = gy + h*size_y;
+		}
+		cursor += (uint8_t)pgm_read_byte(&glyph->xAdvance)*(int16_t)size_x;
+	}
+	if (x0 > x1) {
+		// only blank glyphs
+		x0 = x1 = y0 = y1 = 0;
+	}
+
+	entry = _textCache->add(gfxFont, size_x, size_y, text, length, x1 - x0, y1 - y0);
+	if (entry == nullptr) {
+		return nullptr;
+	}
+	entry->offsetX = x0;
+	entry->offsetY = y0;
+	entry->advance = cursor;
+
+	// set each glyph pixel's size_x by size_y block of the image
+	uint8_t *image = entry->image();
+	cursor = 0;
+	for (uint16_t i = 0; i < length; i++) {
+		if ((text[i] < first)||(text[i] > last)) {
+			continue;
+		}
+		const GFXglyph *glyph = fontGlyph(gfxFont, text[i] - first);
+		const uint8_t *bitmap = fontBitmap(gfxFont) + pgm_read_word(&glyph->bitmapOffset);
+		int16_t w = pgm_read_byte(&glyph->width);
+		int16_t h = pgm_read_byte(&glyph->height);
+		int16_t gx = cursor + (int8_t)pgm_read_byte(&glyph->xOffset)*size_x - x0;
+		int16_t gy = (int8_t)pgm_read_byte(&glyph->yOffset)*size_y - y0;
+		uint16_t bit = 0;
+		for (int16_t yy = 0; yy < h; yy++) {
+			for (int16_t xx = 0; xx < w; xx++, bit++) {
+				if (pgm_read_byte(&bitmap[bit >> 3]) & (0x80 >> (bit&7))) {
+					for (uint8_t k = 0; k < size_y; k++) {
+						uint32_t row = gy + yy*size_y + k;
+						setBitRun(image, row*entry->width + gx + xx*size_x, size_x);
 					}
 				}
 			}
 		}
-		yield();
+		cursor += (uint8_t)pgm_read_byte(&glyph->xAdvance)*(int16_t)size_x;
 	}
-}	
+	return entry;
+}
+
+/*!
+    @brief  Prints a line of text at the text cursor through the text cache, so that
+    		text drawn before is drawn again with one blit per image plane.
+    @param	text	the text, without line breaks.
+    @return the number of characters printed.
+    @note   Draws as print() does with the current font, text size and color, except
+    		that the text does not wrap. Without a text cache or GFXfont font, and for
+    		inverse colors, line breaks or text too large for the cache's budget, the 
+    		text is drawn a character at a time.
+*/
+size_t ePaperCanvas::drawCachedText(const char *text)
+{
+	uint16_t length = strlen(text);
+	// colors the mode does not have, which include the inverse colors, have no writes
+	const ePaperColorBits& bits = colorBits((ePaperColorType)textcolor);
+	ePaperTextCache::Entry *entry = nullptr;
+	if (_textCache && gfxFont && bits.write && !strchr(text, '\n') && !strchr(text, '\r')) {
+		entry = cachedTextImage((const uint8_t *)text, length, textsize_x, textsize_y);
+	}
+	if (entry == nullptr) {
+		bool priorWrap = wrap;
+		wrap = false;
+		for (uint16_t i = 0; i < length; i++) {
+			write(text[i]);
+		}
+		wrap = priorWrap;
+		return length;
+	}
+	if ((entry->width > 0)&&(entry->height > 0)) {
+		blitSolidImage(cursor_x + entry->offsetX, cursor_y + entry->offsetY, entry->width, entry->height,
+						entry->image(), entry->imageSize(), false, bits);
+	}
+	cursor_x += entry->advance;
+	return length;
+}
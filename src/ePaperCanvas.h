@@ -2,6 +2,8 @@
 #define __ePaperCanvas__
 #include <Adafruit_GFX.h>
 #include "ePaperDeviceConfigurations.h"
+#include "ePaperYield.h"
+#include "ePaperTextCache.h"
 
 // these are the color values supported
 typedef uint8_t ePaperColorType;
@@ -16,6 +18,133 @@ const ePaperColorType ePaper_INVERSE1	= 0xF1;		// b -> w, w -> b, c -> w
 const ePaperColorType ePaper_INVERSE2	= 0xF2;		// b -> c or w, w -> b, c -> b
 const ePaperColorType ePaper_INVERSE3	= 0xF3;		// b -> w, w -> c or b, c -> b
 
+// the image planes of the canvas
+typedef enum {
+	IMAGE_PLANE_BLACK,
+	IMAGE_PLANE_COLOR				// the color or second gray scale plane
+} ePaperImagePlane;
+
+// how blitBitImage() combines an image with a plane
+typedef enum {
+	RASTER_OP_COPY,					// the image's bits replace the plane's
+	RASTER_OP_OR,					// sets the plane's bits where the image's are set
+	RASTER_OP_AND_NOT,				// clears the plane's bits where the image's are set
+	RASTER_OP_XOR,					// inverts the plane's bits where the image's are set
+	RASTER_OP_OVERLAY				// sets the plane's bits and clears the other plane's where 
+									// the image's are set, leaving the rest unchanged
+} ePaperRasterOp;
+
+// how the canvas applies the rotation set with setRotation()
+typedef enum {
+	ROTATE_ON_DRAW,					// pixels are rotated into the device's layout as they are drawn
+	ROTATE_ON_SEND					// pixels are stored as drawn, and rotated as the image planes
+									// are sent to the device
+} ePaperRotationMode;
+
+//
+// How a solid color sets the image plane bits. black and color are the value of the
+// color's bit in each plane, 0xFF or 0x00, so a pixel is written by clearing its bit
+// mask and setting the mask's bits of the value. write is 0x00 for the colors that the
+// color mode does not have, which drawPixel() leaves unchanged.
+//
+typedef struct {
+	uint8_t black;
+	uint8_t color;
+	uint8_t write;
+} ePaperColorBits;
+
+// white, gray 1, gray 2, black, color and then any other color
+const uint8_t ePaper_COLOR_INDEX_COUNT = 6;
+
+inline uint8_t ePaperColorIndex(ePaperColorType color)
+{
+	return (color <= ePaper_GRAY2) ? color 
+			: (color == ePaper_BLACK) ? 3 
+			: (color == ePaper_COLOR) ? 4 
+			: 5;
+}
+
+//
+// The compile time particulars of a color mode: how many image planes it has and
+// which plane bits each color sets. The canvas writes pixels through these, so a
+// pixel write has no color mode branches or plane null checks.
+//
+template<ePaperColorMode Mode>
+struct ePaperCanvasT {
+	static constexpr uint8_t planeCount = (Mode == CMODE_BW) ? 1 : 2;
+	static const ePaperColorBits colorBits[ePaper_COLOR_INDEX_COUNT];
+
+	static void writePixel(
+				uint8_t *blackPlane,
+				uint8_t *colorPlane,
+				uint32_t index,
+				uint8_t mask,
+				ePaperColorType color
+			);
+};
+
+template<> const ePaperColorBits ePaperCanvasT<CMODE_BW>::colorBits[ePaper_COLOR_INDEX_COUNT];
+template<> const ePaperColorBits ePaperCanvasT<CMODE_3COLOR>::colorBits[ePaper_COLOR_INDEX_COUNT];
+template<> const ePaperColorBits ePaperCanvasT<CMODE_4GRAY>::colorBits[ePaper_COLOR_INDEX_COUNT];
+
+template<ePaperColorMode Mode>
+void ePaperCanvasT<Mode>::writePixel(
+	uint8_t *blackPlane,
+	uint8_t *colorPlane,
+	uint32_t index,
+	uint8_t mask,
+	ePaperColorType color
+)
+{
+	uint8_t& blackByte = blackPlane[index];
+	switch (color) {
+		case ePaper_INVERSE1:
+			// b -> w, w -> b, c -> w
+			if ((planeCount > 1)&&(colorPlane[index]&mask)) {
+				colorPlane[index] &= ~mask;
+			} else {
+				blackByte ^= mask;
+			}
+			break;
+		case ePaper_INVERSE2:
+			// b -> c or w, w -> b, c -> b
+			if ((planeCount > 1)&&(colorPlane[index]&mask)) {
+				colorPlane[index] &= ~mask;
+				blackByte |= mask;
+			} else if (blackByte&mask) {
+				blackByte &= ~mask;
+				if (planeCount > 1) {
+					colorPlane[index] |= mask;
+				}
+			} else {
+				blackByte |= mask;
+			}
+			break;
+		case ePaper_INVERSE3:
+			// b -> w, w -> c or b, c -> b
+			if ((planeCount > 1)&&(colorPlane[index]&mask)) {
+				colorPlane[index] &= ~mask;
+				blackByte |= mask;
+			} else if (blackByte&mask) {
+				blackByte &= ~mask;
+			} else if (planeCount > 1) {
+				colorPlane[index] |= mask;
+			} else {
+				blackByte |= mask;
+			}
+			break;
+		default: {
+			const ePaperColorBits& bits = colorBits[ePaperColorIndex(color)];
+			mask &= bits.write;
+			blackByte = (blackByte & ~mask)|(bits.black & mask);
+			if (planeCount > 1) {
+				colorPlane[index] = (colorPlane[index] & ~mask)|(bits.color & mask);
+			}
+			break;
+		}
+	}
+}
+
 
 class ePaperCanvas : public Adafruit_GFX {
 public:
@@ -29,16 +158,144 @@ private:
 	uint8_t *_colorBuffer;		// used for bit 2 in color or gray scale displays
 	
 	const ePaperColorMode 	_mode;
+	const ePaperColorBits	*_colorBits;	// the mode's ePaperCanvasT<>::colorBits
+
+	// the image buffer layout. With ROTATE_ON_SEND the buffers hold the screen in the
+	// current rotation, which _sendRotation is, and otherwise the device's unrotated image.
+	ePaperRotationMode _rotationMode;
+	uint8_t _sendRotation;
+	int16_t _bufferWidth;
+	int16_t _bufferHeight;
+	uint16_t _rowBytes;
+
+	// bounding box of the pixels changed since the last clearDirtyRect(), in image
+	// buffer coordinates. empty when _dirtyX0 > _dirtyX1.
+	int16_t _dirtyX0;
+	int16_t _dirtyY0;
+	int16_t _dirtyX1;
+	int16_t _dirtyY1;
 	
-	void getBitSettingsForColor(uint16_t color, bool& blackBit, bool& colorBit );
+	void markDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+		if (x0 < _dirtyX0) _dirtyX0 = x0 & ~7;
+		if (x1 > _dirtyX1) _dirtyX1 = x1 | 7;
+		if (y0 < _dirtyY0) _dirtyY0 = y0;
+		if (y1 > _dirtyY1) _dirtyY1 = y1;
+	}
+	void markAllDirty(void)					{ markDirty(0, 0, _bufferWidth - 1, _bufferHeight - 1); }
+
+	// whether each plane may differ from what was last sent to the device
+	bool _blackPlaneModified;
+	bool _colorPlaneModified;
+
+	ePaperTextCache *_textCache;
+
+	// writes a solid color's bits to the mask's pixels of a byte of each plane
+	void writePlaneBits(uint32_t index, uint8_t mask, const ePaperColorBits& bits) {
+		uint8_t priorByte = _blackBuffer[index];
+		_blackBuffer[index] = (priorByte & ~mask)|(bits.black & mask);
+		if (_blackBuffer[index] != priorByte) _blackPlaneModified = true;
+		if (_colorBuffer) {
+			priorByte = _colorBuffer[index];
+			_colorBuffer[index] = (priorByte & ~mask)|(bits.color & mask);
+			if (_colorBuffer[index] != priorByte) _colorPlaneModified = true;
+		}
+	}
+	// the rotation drawing has to apply to reach the image buffer layout
+	uint8_t bufferRotation(void) const		{ return (_rotationMode == ROTATE_ON_SEND) ? 0 : getRotation(); }
+	void updateBufferLayout(void);
+	void rotateToBuffer(int16_t& x, int16_t& y) const;
+	bool clipToScreen(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const;
+	void rotateRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h, uint8_t rotation) const;
+	bool mapToBufferRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const;
+	void fillPlaneBytes(uint32_t index, uint32_t count, const ePaperColorBits& bits);
+	bool blitPlane(
+				uint8_t *plane,
+				int16_t loc_x, int16_t loc_y,
+				int16_t img_w, int16_t img_h,
+				const uint8_t* bitMap,
+				uint32_t bitMapSize,
+				bool bitMapIsProgMem,
+				ePaperRasterOp op
+			);
+	bool blitPlaneRotated(
+				uint8_t *plane,
+				int16_t loc_x, int16_t loc_y,
+				int16_t img_w,
+				int16_t x0, int16_t y0,
+				int16_t x1, int16_t y1,
+				const uint8_t* bitMap,
+				uint32_t bitMapSize,
+				bool bitMapIsProgMem,
+				ePaperRasterOp op
+			);
 	void drawFastRawHLine(int16_t x, int16_t y, int16_t w, ePaperColorType color);
 	void drawFastRawVLine(int16_t x, int16_t y, int16_t h, ePaperColorType color);
+	bool drawFontGlyph(
+				int16_t x, int16_t y,
+				unsigned char c,
+				uint16_t color,
+				uint8_t size_x, uint8_t size_y
+			);
+	ePaperTextCache::Entry *cachedTextImage(
+				const uint8_t *text,
+				uint16_t length,
+				uint8_t size_x, uint8_t size_y
+			);
+	void blitSolidImage(
+				int16_t loc_x, int16_t loc_y,
+				int16_t img_w, int16_t img_h,
+				const uint8_t* bitMap,
+				uint32_t bitMapSize,
+				bool bitMapIsProgMem,
+				const ePaperColorBits& bits
+			);
 	
 protected:
 	ePaperColorMode getColorMode(void) const		{ return _mode; }
 	uint32_t getBufferrSize(void) const			{ return _bufferSize; }
 	const uint8_t *getBuffer1(void) const 		{ return _blackBuffer; }
 	const uint8_t *getBuffer2(void) const 		{ return _colorBuffer; }
+	uint8_t *getWritableBuffer1(void)			{ return _blackBuffer; }
+	uint8_t *getWritableBuffer2(void)			{ return _colorBuffer; }
+
+	// plane bits of a solid color in this canvas' color mode
+	const ePaperColorBits& colorBits(ePaperColorType color) const
+											{ return _colorBits[ePaperColorIndex(color)]; }
+
+	// drawPixel() for a canvas known to have the color mode Mode
+	template<ePaperColorMode Mode> void drawPixelInMode(int16_t x, int16_t y, ePaperColorType color);
+
+	bool mapToDeviceRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const;
+
+	// Whether the image buffers are not in the device's layout, in which case the planes
+	// are read for sending with getDeviceBytes() rather than directly.
+	bool isRotatedOnSend(void) const			{ return _sendRotation != 0; }
+	void getDeviceBytes(
+				const uint8_t *plane,
+				int16_t row,
+				int16_t byteX,
+				uint16_t count,
+				uint8_t *bytes
+			) const;
+
+	// Whether device rows are image buffer columns, in which case getDeviceRows() reads 
+	// several at a time.
+	bool isTransposedOnSend(void) const			{ return (_sendRotation & 1) != 0; }
+	uint8_t getDeviceRows(
+				const uint8_t *plane,
+				int16_t row,
+				int16_t lastRow,
+				int16_t byteX,
+				uint16_t count,
+				uint8_t *bytes
+			) const;
+
+	// Plane change tracking, so that the driver can skip sending a plane that the
+	// device still has. Pass getBuffer1() or getBuffer2() as the plane.
+	bool isPlaneModified(const uint8_t *plane) const
+											{ return plane == _blackBuffer ? _blackPlaneModified : _colorPlaneModified; }
+	void clearPlaneModified(const uint8_t *plane);
+	void markPlanesModified(void)			{ _blackPlaneModified = true; _colorPlaneModified = true; }
 	
 public:	
 	ePaperCanvas(
@@ -59,11 +316,55 @@ public:
 											{ this->drawPixel(x, y, (ePaperColorType)color); }
 	virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
 	virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+	virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
 	
 	virtual void fillScreen(uint16_t color);
 
 	virtual void invertDisplay(boolean i);
 
+	//
+	// Text. The glyphs of GFXfont fonts are blitted into the image planes, at any text
+	// size. The built in font and the inverse colors are drawn by Adafruit_GFX.
+	//
+
+	using Adafruit_GFX::write;
+	virtual size_t write(uint8_t c);
+	void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size)
+												{ this->drawChar(x, y, c, color, bg, size, size); }
+	void drawChar(
+				int16_t x, int16_t y,
+				unsigned char c,
+				uint16_t color,
+				uint16_t bg,
+				uint8_t size_x, uint8_t size_y
+			);
+
+	// Text drawn with a GFXfont font can be kept rasterized in a cache, which the
+	// caller owns. Scaled glyphs are then drawn from it, as is drawCachedText().
+	void setTextCache(ePaperTextCache *cache)	{ _textCache = cache; }
+	ePaperTextCache *textCache(void) const		{ return _textCache; }
+	size_t drawCachedText(const char *text);
+
+	virtual void setRotation(uint8_t r);
+	void setRotationMode(ePaperRotationMode mode);
+	ePaperRotationMode rotationMode(void) const	{ return _rotationMode; }
+
+	//
+	// Changed area tracking. The dirty rectangle bounds every pixel written since it
+	// was last cleared. It is in the device's unrotated coordinates, with the left 
+	// and right edges widened to whole bytes of the image buffer rows.
+	//
+
+	bool isDirty(void) const					{ return _dirtyX0 <= _dirtyX1; }
+	bool getDirtyRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const;
+	void clearDirtyRect(void);
+
+	// A 32 bit digest of the image buffer contents
+	uint32_t getImageHash(void) const;
+
+	// Whether the image buffer has no color or gray pixels
+	bool hasOnlyBlackAndWhite(void) const;
+
 	// direct image 
 	void setDeviceImage( 
 				const uint8_t* blackBitMap,
@@ -91,7 +392,39 @@ public:
 				bool colorBitMapIsProgMem
 			);
 
+	void blitBitImage(
+				int16_t loc_x, int16_t loc_y,
+				int16_t img_w, int16_t img_h,
+				const uint8_t* bitMap,
+				uint32_t bitMapSize,
+				bool bitMapIsProgMem,
+				ePaperImagePlane plane,
+				ePaperRasterOp op
+			);
+
 };
 
+template<ePaperColorMode Mode>
+void ePaperCanvas::drawPixelInMode(int16_t x, int16_t y, ePaperColorType color)
+{
+	if((x >= 0) && (x < width()) && (y >= 0) && (y < height())) {
+		rotateToBuffer(x, y);
+		markDirty(x, y, x, y);
+		uint32_t buffer_index = (uint32_t)y*_rowBytes + (x >> 3);
+		uint8_t buffer_bit_mask = 0x80 >> (x&7);
+		uint8_t priorBlackByte = _blackBuffer[buffer_index];
+		uint8_t priorColorByte = (ePaperCanvasT<Mode>::planeCount > 1) ? _colorBuffer[buffer_index] : 0;
+
+		ePaperCanvasT<Mode>::writePixel(_blackBuffer, _colorBuffer, buffer_index, buffer_bit_mask, color);
+
+		if (_blackBuffer[buffer_index] != priorBlackByte) {
+			_blackPlaneModified = true;
+		}
+		if ((ePaperCanvasT<Mode>::planeCount > 1)&&(_colorBuffer[buffer_index] != priorColorByte)) {
+			_colorPlaneModified = true;
+		}
+	}
+	ePaperYield::yieldIfDue();
+}
 
 #endif // __ePaperCanvas__
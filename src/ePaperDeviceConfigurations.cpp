@@ -22,321 +22,176 @@
 //
 #include <Arduino.h>
 #include "ePaperDeviceConfigurations.h"
-#include "ePaperSettings.h"
+#include "ePaperModelDescriptors.h"
 
-const uint8_t* ePaperDeviceConfigurations::deviceConfigurationCMD(ePaperDeviceModel model)
-{
-	switch (model) {
-		case CFAP104212C0_0213:
-		case CFAP104212E0_0213:
-			return deviceConfiguration_CFAP104212E0_0213;
-			break;
-		case CFAP176264A0_0270:
-			return deviceConfiguration_GDEW027C44;
-			break;
-		case CFAP400300C0_420:
-		case CFAP400300A0_420:
-			return deviceConfiguration_CFAP4003002A0_0420;
-			break;
-		case CFAP200200A1_0154:
-			return deviceConfiguration_CFAP200200A1_0154;
+// indexed by ePaperDeviceModel
+static const ePaperModelDescriptor modelDescriptors[] PROGMEM = {
+	ePaperSettings::modelDescriptor<CFAP200200A1_0154>(),
+	ePaperSettings::modelDescriptor<CFAP104212C0_0213>(),
+	ePaperSettings::modelDescriptor<CFAP104212E0_0213>(),
+	ePaperSettings::modelDescriptor<CFAP176264A0_0270>(),
+	ePaperSettings::modelDescriptor<CFAP400300A0_420>(),
+	ePaperSettings::modelDescriptor<CFAP400300C0_420>(),
+	ePaperSettings::modelDescriptor<GDEW026Z39>(),
+	ePaperSettings::modelDescriptor<GDEW027C44>(),
+	ePaperSettings::modelDescriptor<GDEW029Z10>(),
+	ePaperSettings::modelDescriptor<GDEW0371Z80>(),
+	ePaperSettings::modelDescriptor<GDEW0371W7>(),
+	ePaperSettings::modelDescriptor<GDEW042T2>(),
+	ePaperSettings::modelDescriptor<GDEW0154T8>(),
+	ePaperSettings::modelDescriptor<GDEW029T5>(),
+	ePaperSettings::modelDescriptor<GDEW0213T5>()
+};
+
+static const uint16_t modelCount = sizeof(modelDescriptors)/sizeof(modelDescriptors[0]);
 
-		case GDEW026Z39:
-			return deviceConfiguration_GDEW026Z39;
-			break;
-		case GDEW027C44:
-			return deviceConfiguration_GDEW027C44;
-			break;
-		case GDEW029Z10:
-			return deviceConfiguration_GDEW029Z10;
-			break;
-		case GDEW0371Z80:
-			return deviceConfiguration_GDEW0371Z80;
-			break;
-		case GDEW0371W7:
-			return deviceConfiguration_GDEW0371W7;
-			break;
-		case GDEW042T2:
-			return deviceConfiguration_GDEW042T2;
-			break;
-		case GDEW0154T8:
-			return deviceConfiguration_GDEW0154T8;
-			break;
-		case GDEW029T5:
-			return deviceConfiguration_GDEW029T5;
-			break;
-		case GDEW0213T5:
-			return deviceConfiguration_GDEW0213T5;
-			break;
-		
-		default:
-			return 0;
-			break;
+/*!
+    @brief  Looks up the descriptor of a device model.
+    @param	model	the device model.
+    @return a copy of the model's descriptor, all zeros for an unknown model.
+*/
+ePaperModelDescriptor ePaperDeviceConfigurations::modelDescriptor(ePaperDeviceModel model)
+{
+	ePaperModelDescriptor descriptor;
+	if ((uint16_t)model < modelCount) {
+		memcpy_P(&descriptor, &modelDescriptors[model], sizeof(descriptor));
+	} else {
+		memset(&descriptor, 0, sizeof(descriptor));
 	}
+	return descriptor;
 }
 
-uint8_t ePaperDeviceConfigurations::deviceConfigurationCMDSize(ePaperDeviceModel model)
+const uint8_t* ePaperDeviceConfigurations::deviceConfigurationCMD(ePaperDeviceModel model)
 {
-	switch (model) {
-		case CFAP104212C0_0213:
-		case CFAP104212E0_0213:
-			return pgm_read_byte(&deviceConfigurationSize_CFAP104212E0_0213);
-			break;
-		case CFAP176264A0_0270:
-			return pgm_read_byte(&deviceConfigurationSize_GDEW027C44);
-			break;
-		case CFAP400300A0_420:
-		case CFAP400300C0_420:
-			return pgm_read_byte(&deviceConfigurationSize_CFAP4003002A0_0420);
-			break;
-		case CFAP200200A1_0154:
-			return sizeof(deviceConfiguration_CFAP200200A1_0154);
-			break;
+	return modelDescriptor(model).configuration.bytes;
+}
 
-		case GDEW026Z39:
-			return pgm_read_byte(&deviceConfigurationSize_GDEW026Z39);
-			break;
-		case GDEW027C44:
-			return pgm_read_byte(&deviceConfigurationSize_GDEW027C44);
-			break;
-		case GDEW029Z10:
-			return pgm_read_byte(&deviceConfigurationSize_GDEW029Z10);
-			break;
-		case GDEW0371Z80:
-			return pgm_read_byte(&deviceConfigurationSize_GDEW0371Z80);
-			break;
-		case GDEW0371W7:
-			return pgm_read_byte(&deviceConfigurationSize_GDEW0371W7);
-			break;
-		case GDEW042T2:
-			return pgm_read_byte(&deviceConfigurationSize_GDEW042T2);
-			break;
-		case GDEW0154T8:
-			return pgm_read_byte(&deviceConfigurationSize_GDEW0154T8);
-			break;
-		case GDEW029T5:
-			return pgm_read_byte(&deviceConfigurationSize_GDEW029T5);
-			break;
-		case GDEW0213T5:
-			return pgm_read_byte(&deviceConfigurationSize_GDEW0213T5);
-			break;
-		default:
-			return 0;
-			break;
-	}
+uint16_t ePaperDeviceConfigurations::deviceConfigurationCMDSize(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).configuration.size;
 }
 
 const uint8_t* ePaperDeviceConfigurations::setImageAndRefreshCMD(ePaperDeviceModel model)
 {
-	switch (model) {
-		case CFAP104212C0_0213:
-		case CFAP104212E0_0213:
-		case CFAP176264A0_0270:
-		case CFAP400300C0_420:
-		case CFAP400300A0_420:
-		case GDEW026Z39:
-		case GDEW027C44:
-		case GDEW029Z10:
-		case GDEW0371Z80:
-			return setImage_CMD_3color;
-			break;
-		case GDEW0371W7:
-		case GDEW042T2:
-		case GDEW0154T8:
-		case GDEW029T5:
-		case GDEW0213T5:
-			return setImage_CMD_4gray;
-			break;
-		case CFAP200200A1_0154:
-			return setFullScreenImage_CMD_CFAP200200A1_0154;
-			break;
-		default:
-			return 0;
-			break;
-	}
+	return modelDescriptor(model).setImageAndRefresh.bytes;
 }
 
 uint16_t ePaperDeviceConfigurations::setImageAndRefreshCMDSize(ePaperDeviceModel model)
 {
-	switch (model) {
-		case CFAP104212C0_0213:
-		case CFAP104212E0_0213:
-		case CFAP176264A0_0270:
-		case CFAP400300C0_420:
-		case CFAP400300A0_420:
-		case GDEW026Z39:
-		case GDEW027C44:
-		case GDEW029Z10:
-		case GDEW0371Z80:
-			return setImage_CMD_3color_size;
-			break;
-		case GDEW0371W7:
-		case GDEW042T2:
-		case GDEW0154T8:
-		case GDEW029T5:
-		case GDEW0213T5:
-			return setImage_CMD_4gray_size;
-			break;
-		case CFAP200200A1_0154:
-			return sizeof(setFullScreenImage_CMD_CFAP200200A1_0154);
-			break;
-		default:
-			return 0;
-			break;
-	}
+	return modelDescriptor(model).setImageAndRefresh.size;
+}
+
+const uint8_t* ePaperDeviceConfigurations::lutCMD(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).lut.bytes;
+}
+
+uint16_t ePaperDeviceConfigurations::lutCMDSize(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).lut.size;
+}
+
+const uint8_t* ePaperDeviceConfigurations::setImageAndFastRefreshCMD(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).setImageAndFastRefresh.bytes;
+}
+
+uint16_t ePaperDeviceConfigurations::setImageAndFastRefreshCMDSize(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).setImageAndFastRefresh.size;
+}
+
+const uint8_t* ePaperDeviceConfigurations::fastRefreshLUTCMD(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).fastRefreshLUT.bytes;
+}
+
+uint16_t ePaperDeviceConfigurations::fastRefreshLUTCMDSize(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).fastRefreshLUT.size;
+}
+
+const uint8_t* ePaperDeviceConfigurations::otpLUTCMD(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).otpLUT.bytes;
+}
+
+uint16_t ePaperDeviceConfigurations::otpLUTCMDSize(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).otpLUT.size;
 }
 
+ePaperPartialWindowMode ePaperDeviceConfigurations::devicePartialWindowMode(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).partialWindowMode;
+}
+
+const uint8_t* ePaperDeviceConfigurations::refreshRegionCMD(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).refreshRegion.bytes;
+}
+
+uint16_t ePaperDeviceConfigurations::refreshRegionCMDSize(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).refreshRegion.size;
+}
+
+const uint8_t* ePaperDeviceConfigurations::powerOnCMD(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).powerOn.bytes;
+}
+
+uint16_t ePaperDeviceConfigurations::powerOnCMDSize(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).powerOn.size;
+}
+
+const uint8_t* ePaperDeviceConfigurations::sleepCMD(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).sleep.bytes;
+}
+
+uint16_t ePaperDeviceConfigurations::sleepCMDSize(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).sleep.size;
+}
+
+uint16_t ePaperDeviceConfigurations::deviceResetPulseMillis(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).resetPulseMillis;
+}
+
+uint16_t ePaperDeviceConfigurations::deviceResetRecoveryMillis(ePaperDeviceModel model)
+{
+	return modelDescriptor(model).resetRecoveryMillis;
+}
 
 int ePaperDeviceConfigurations::deviceSizeVertical(ePaperDeviceModel model)
 {
-	switch (model) {
-		case GDEW0154T8:
-			return 152;
-			break;
-		case CFAP104212C0_0213:
-		case CFAP104212E0_0213:
-		case GDEW0213T5:
-			return 212;
-			break;
-		case GDEW027C44:
-		case CFAP176264A0_0270:
-			return 264;
-			break;
-		case CFAP400300A0_420:
-		case CFAP400300C0_420:
-		case GDEW042T2:
-			return 300;
-			break;
-		case GDEW026Z39:
-		case GDEW029T5:
-		case GDEW029Z10:
-			return 296;
-			break;
-		case GDEW0371Z80:
-		case GDEW0371W7:
-			return 416;
-			break;
-		case CFAP200200A1_0154:
-			return 200;
-			break;
-		default:
-			return 0;
-			break;
-	}
+	return modelDescriptor(model).height;
 }
 
 int ePaperDeviceConfigurations::deviceSizeHorizontal(ePaperDeviceModel model)
 {
-	switch (model) {
-		case CFAP104212C0_0213:
-		case CFAP104212E0_0213:
-		case GDEW0213T5:
-			return 104;
-			break;
-		case GDEW027C44:
-		case CFAP176264A0_0270:
-			return 176;
-			break;
-		case CFAP400300A0_420:
-		case CFAP400300C0_420:
-		case GDEW042T2:
-			return 400;
-			break;
-		case GDEW026Z39:
-		case GDEW0154T8:
-			return 152;
-			break;
-		case GDEW029Z10:
-		case GDEW029T5:
-			return 128;
-			break;
-		case GDEW0371Z80:
-		case GDEW0371W7:
-			return 240;
-			break;
-		case CFAP200200A1_0154:
-			return 200;
-			break;
-		default:
-			return 0;
-			break;
-	}
+	return modelDescriptor(model).width;
 }
 
-
 ePaperColorMode ePaperDeviceConfigurations::deviceColorMode(ePaperDeviceModel model)
 {
-	switch (model) {
-		case CFAP104212C0_0213:
-		case CFAP104212E0_0213:
-		case CFAP176264A0_0270:
-		case CFAP400300A0_420:
-		case CFAP400300C0_420:
-		case GDEW026Z39:
-		case GDEW027C44:
-		case GDEW029Z10:
-		case GDEW0371Z80:
-			return CMODE_3COLOR;
-			break;
-		case GDEW0371W7:
-		case GDEW042T2:
-		case GDEW0154T8:
-		case GDEW029T5:
-		case GDEW0213T5:
-			return CMODE_4GRAY;
-			break;
-		default:
-			return CMODE_BW;
-			break;
-	}
+	return modelDescriptor(model).colorMode;
 }
 
 bool ePaperDeviceConfigurations::deviceUsesInvertedBlackBits(ePaperDeviceModel model)
 {
-	switch (model) {
-		case GDEW026Z39:
-		case GDEW029Z10:
-		case GDEW0371Z80:
-		case GDEW0371W7:
-		case GDEW042T2:
-		case GDEW0154T8:
-		case GDEW029T5:
-		case GDEW0213T5:
-		case CFAP200200A1_0154:
-			return true;
-			break;
-		default:
-			return false;
-			break;
-	}
+	return modelDescriptor(model).invertedBlackBits;
 }
 
 bool ePaperDeviceConfigurations::deviceUsesInvertedColorBits(ePaperDeviceModel model)
 {
-	switch (model) {
-		case GDEW026Z39:
-		case GDEW029Z10:
-		case GDEW0371W7:
-		case GDEW042T2:
-		case GDEW0154T8:
-		case GDEW029T5:
-		case GDEW0213T5:
-			return true;
-			break;
-		default:
-			return false;
-			break;
-	}
+	return modelDescriptor(model).invertedColorBits;
 }
+
 uint8_t ePaperDeviceConfigurations::deviceBusyValue(ePaperDeviceModel model)
 {
-	switch (model) {
-		case CFAP200200A1_0154:
-			// documentation says it should be LOW, but sample code and reality says is is HIGH
-			return HIGH;
-			break;
-		default:
-			return LOW;
-			break;
-	}
+	return modelDescriptor(model).busyValue;
 }
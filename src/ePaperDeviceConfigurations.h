@@ -31,14 +31,123 @@ typedef enum {
 	CMODE_4GRAY
 } ePaperColorMode;
 
+//
+// The phases of a refresh. Command sequences mark the start of a phase with the
+// 0xFB directive followed by one of these values.
+//
+typedef enum {
+	PHASE_RESET,
+	PHASE_CONFIGURATION,
+	PHASE_IMAGE,			// image sequence commands not part of another phase
+	PHASE_BLACK_PLANE,
+	PHASE_COLOR_PLANE,
+	PHASE_LUT_UPLOAD,
+	PHASE_UPDATE,			// display update command and the wait for it to finish
+	PHASE_POWER_OFF,
+	PHASE_COUNT
+} ePaperRefreshPhase;
+
+//
+// The power state of the device's controller. Command sequences note a change of
+// power state with the 0xFA directive followed by one of these values.
+//
+typedef enum {
+	POWER_STATE_UNKNOWN,		// needs a hardware reset before use
+	POWER_STATE_RESET,			// hardware reset, not yet configured
+	POWER_STATE_INITIALIZED,	// configured with the booster powered off
+	POWER_STATE_POWERED,		// configured and powered on
+	POWER_STATE_DEEP_SLEEP		// needs a hardware reset to wake up
+} ePaperPowerState;
+
+//
+// What to do with the device once a refresh has completed
+//
+typedef enum {
+	POWER_POLICY_ALWAYS_SLEEP,		// power off and deep sleep after every refresh
+	POWER_POLICY_STAY_POWERED,		// leave powered for the next refresh
+	POWER_POLICY_SLEEP_WHEN_IDLE	// stay powered, deep sleep once idle for a while
+} ePaperPowerPolicy;
+
+//
+// How a device's controller is told to update part of the screen
+//
+typedef enum {
+	PARTIAL_WINDOW_NONE,			// full screen refreshes only
+	PARTIAL_WINDOW_UC81XX,			// partial window command 0x90 with 8 bit horizontal positions
+	PARTIAL_WINDOW_UC81XX_WIDE,		// partial window command 0x90 with 9 bit horizontal positions
+	PARTIAL_WINDOW_SSD_RAM			// RAM window (0x44/0x45) and address counters (0x4E/0x4F)
+} ePaperPartialWindowMode;
 
+//
+// A command sequence in PROGMEM, such as the bytes of an ePaperCommandSequence. A
+// device without the sequence has a null bytes pointer.
+//
+typedef struct {
+	const uint8_t *bytes;
+	uint16_t size;
+} ePaperSequenceRef;
+
+//
+// Everything the driver needs to know about a device model. Each model's descriptor is
+// a compile time constant, see ePaperModelDescriptors.h.
+//
+typedef struct {
+	int16_t width;								// unrotated horizontal pixels
+	int16_t height;								// unrotated vertical pixels
+	ePaperColorMode colorMode;
+	bool invertedBlackBits;						// device expects the black plane's bits inverted
+	bool invertedColorBits;						// device expects the color plane's bits inverted
+	uint8_t busyValue;							// BUSY pin level while the device is busy
+	uint16_t resetPulseMillis;
+	uint16_t resetRecoveryMillis;
+	ePaperPartialWindowMode partialWindowMode;
+	ePaperSequenceRef configuration;			// sent after a hardware reset
+	ePaperSequenceRef powerOn;					// powers on a configured device
+	ePaperSequenceRef setImageAndRefresh;
+	ePaperSequenceRef lut;						// default LUTs, for devices using register LUTs
+	ePaperSequenceRef refreshRegion;
+	ePaperSequenceRef setImageAndFastRefresh;	// for REFRESH_MODE_FAST
+	ePaperSequenceRef fastRefreshLUT;
+	ePaperSequenceRef otpLUT;					// switches back to OTP LUTs after fastRefreshLUT
+	ePaperSequenceRef sleep;
+} ePaperModelDescriptor;
+
+//
+// Run time lookups of the model descriptors. These pull every model's descriptor
+// and command sequences into the program, which ePaperDisplayT avoids.
+//
 namespace ePaperDeviceConfigurations {
 
+	ePaperModelDescriptor modelDescriptor(ePaperDeviceModel model);
+
 	const uint8_t* deviceConfigurationCMD(ePaperDeviceModel model);
-	uint8_t deviceConfigurationCMDSize(ePaperDeviceModel model);
+	uint16_t deviceConfigurationCMDSize(ePaperDeviceModel model);
 
 	const uint8_t* setImageAndRefreshCMD(ePaperDeviceModel model);
 	uint16_t setImageAndRefreshCMDSize(ePaperDeviceModel model);
+
+	const uint8_t* lutCMD(ePaperDeviceModel model);
+	uint16_t lutCMDSize(ePaperDeviceModel model);
+
+	const uint8_t* setImageAndFastRefreshCMD(ePaperDeviceModel model);
+	uint16_t setImageAndFastRefreshCMDSize(ePaperDeviceModel model);
+	const uint8_t* fastRefreshLUTCMD(ePaperDeviceModel model);
+	uint16_t fastRefreshLUTCMDSize(ePaperDeviceModel model);
+	const uint8_t* otpLUTCMD(ePaperDeviceModel model);
+	uint16_t otpLUTCMDSize(ePaperDeviceModel model);
+
+	ePaperPartialWindowMode devicePartialWindowMode(ePaperDeviceModel model);
+	const uint8_t* refreshRegionCMD(ePaperDeviceModel model);
+	uint16_t refreshRegionCMDSize(ePaperDeviceModel model);
+
+	const uint8_t* powerOnCMD(ePaperDeviceModel model);
+	uint16_t powerOnCMDSize(ePaperDeviceModel model);
+
+	const uint8_t* sleepCMD(ePaperDeviceModel model);
+	uint16_t sleepCMDSize(ePaperDeviceModel model);
+
+	uint16_t deviceResetPulseMillis(ePaperDeviceModel model);
+	uint16_t deviceResetRecoveryMillis(ePaperDeviceModel model);
 	
 	int deviceSizeVertical(ePaperDeviceModel model);
 	int deviceSizeHorizontal(ePaperDeviceModel model);
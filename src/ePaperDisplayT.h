@@ -0,0 +1,80 @@
+//     ePaper Driver Lib for Arduino Project
+//     Copyright (C) 2019 Michael Kamprath
+//
+//     This file is part of ePaper Driver Lib for Arduino Project.
+// 
+//     ePaper Driver Lib for Arduino Project is free software: you can 
+//	   redistribute it and/or modify it under the terms of the GNU General Public License
+//     as published by the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     ePaper Driver Lib for Arduino Project is distributed in the hope that 
+// 	   it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+//     You should have received a copy of the GNU General Public License
+//     along with Shift Register LED Matrix Project.  If not, see <http://www.gnu.org/licenses/>.
+//
+//     This project and its creators are not associated with Crystalfontz, Good display
+//	   or any other manufacturer, nor is this  project officially endorsed or reviewed for 
+//	   correctness by any ePaper manufacturer. 
+//
+#ifndef __ePaperDisplayT__
+#define __ePaperDisplayT__
+#include "ePaperDriver.h"
+#include "ePaperModelDescriptors.h"
+
+//
+// An ePaperDisplay for a device model chosen at compile time:
+//
+//		ePaperDisplayT<GDEW042T2> device(readyPin, resetPin, dataCommandPin, selectPin);
+//
+// The model's descriptor is a compile time constant, so only that model's command
+// sequences are linked into the program, and its dimensions and flags are available
+// as constants for model specific code. Pixels are drawn with the pixel writes of the
+// model's color mode, see ePaperCanvasT.
+//
+template<ePaperDeviceModel Model>
+class ePaperDisplayT : public ePaperDisplay {
+public:
+	static constexpr ePaperModelDescriptor modelDescriptor(void)
+												{ return ePaperSettings::modelDescriptor<Model>(); }
+
+	static constexpr int16_t deviceWidth = modelDescriptor().width;
+	static constexpr int16_t deviceHeight = modelDescriptor().height;
+	static constexpr ePaperColorMode colorMode = modelDescriptor().colorMode;
+	static constexpr bool invertedBlackBits = modelDescriptor().invertedBlackBits;
+	static constexpr bool invertedColorBits = modelDescriptor().invertedColorBits;
+	static constexpr uint32_t planeSize = (uint32_t)deviceWidth*deviceHeight/8;
+	static constexpr uint16_t rowBytes = deviceWidth/8;
+
+	ePaperDisplayT(
+		int deviceReadyPin,
+		int deviceResetPin,
+		int deviceDataCommandPin,
+		int deviceSelectPin
+	) :	ePaperDisplay(
+			Model,
+			modelDescriptor(),
+			deviceReadyPin,
+			deviceResetPin,
+			deviceDataCommandPin,
+			deviceSelectPin
+		)
+	{}
+
+	// the pixel writes of the model's color mode, without the run time dispatch
+	virtual void drawPixel(int16_t x, int16_t y, uint16_t color)
+								{ drawPixelInMode<colorMode>(x, y, (ePaperColorType)color); }
+};
+
+template<ePaperDeviceModel Model> constexpr int16_t ePaperDisplayT<Model>::deviceWidth;
+template<ePaperDeviceModel Model> constexpr int16_t ePaperDisplayT<Model>::deviceHeight;
+template<ePaperDeviceModel Model> constexpr ePaperColorMode ePaperDisplayT<Model>::colorMode;
+template<ePaperDeviceModel Model> constexpr bool ePaperDisplayT<Model>::invertedBlackBits;
+template<ePaperDeviceModel Model> constexpr bool ePaperDisplayT<Model>::invertedColorBits;
+template<ePaperDeviceModel Model> constexpr uint32_t ePaperDisplayT<Model>::planeSize;
+template<ePaperDeviceModel Model> constexpr uint16_t ePaperDisplayT<Model>::rowBytes;
+
+#endif // __ePaperDisplayT__
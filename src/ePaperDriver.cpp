@@ -34,6 +34,28 @@
 
 #define DEBUG 0
 
+#if ePaper_REFRESH_STATS
+#define REFRESH_STATS(statement) statement
+#else
+#define REFRESH_STATS(statement)
+#endif
+
+#define BUSY_POLL_MIN_MILLIS			2
+#define BUSY_POLL_MAX_MILLIS			64
+#define BUSY_TIMEOUT_DEFAULT_MILLIS		60000
+#define BUSY_TIMEOUT_DEFAULT_RETRIES	1
+
+// compiled sequence directive for a data block that does not directly follow a command
+#define SEQUENCE_OP_DATA				0x01
+
+#if defined(ESP8266) || defined(ESP32)
+#define ISR_ATTR IRAM_ATTR
+#else
+#define ISR_ATTR
+#endif
+
+ePaperDisplay *ePaperDisplay::busyInterruptOwners[2] = { nullptr, nullptr };
+
 #if DEBUG
 #define DEBUG_PRINTLN(s) Serial.println(s)
 #define DEBUG_PRINT(s) Serial.print(s)
@@ -51,19 +73,101 @@ ePaperDisplay::ePaperDisplay(
 		int deviceResetPin,
 		int deviceDataCommandPin,
 		int deviceSelectPin
+	) :	ePaperDisplay(
+			model,
+			ePaperDeviceConfigurations::modelDescriptor(model),
+			deviceReadyPin,
+			deviceResetPin,
+			deviceDataCommandPin,
+			deviceSelectPin
+		)
+{
+}
+
+/*!
+    @brief  Constructs a display for a device model described by the passed descriptor,
+    		which is copied.
+    @note   Used by ePaperDisplayT with a compile time descriptor, so that the run time
+    		model descriptor table is not needed.
+*/
+ePaperDisplay::ePaperDisplay(
+		ePaperDeviceModel model,
+		const ePaperModelDescriptor& descriptor,
+		int deviceReadyPin,
+		int deviceResetPin,
+		int deviceDataCommandPin,
+		int deviceSelectPin
 	) :	ePaperCanvas(
-				ePaperDeviceConfigurations::deviceSizeHorizontal(model),
-				ePaperDeviceConfigurations::deviceSizeVertical(model),
-				ePaperDeviceConfigurations::deviceColorMode(model)
+				descriptor.width,
+				descriptor.height,
+				descriptor.colorMode
 			),
 		_model( model ),
+		_descriptor( descriptor ),
 		_deviceReadyPin( deviceReadyPin ),
 		_deviceResetPin( deviceResetPin ),
 		_deviceDataCommandPin( deviceDataCommandPin ),
 		_deviceSelectPin( deviceSelectPin ),
-		_configuration(ePaperDeviceConfigurations::deviceConfigurationCMD(model)),
-		_configurationSize(ePaperDeviceConfigurations::deviceConfigurationCMDSize(model))
+		_waitCallbackFunc(nullptr),
+		_transferCompleteCallbackFunc(nullptr),
+		_spiTransport(),
+		_transport(&_spiTransport),
+		_transferPlane(nullptr),
+		_transferPlaneInverted(false),
+		_refreshState(REFRESH_IDLE),
+		_sequence(nullptr),
+		_sequenceOps(nullptr),
+		_sequenceSize(0),
+		_sequenceIndex(0),
+		_sequenceWaitingForReady(false),
+		_delayStartMillis(0),
+		_delayMillis(0),
+		_busyInterruptSlot(-1),
+		_busyReleased(false),
+		_busyReleasedMillis(0),
+		_busyWaitStartMillis(0),
+		_busyNextPollMillis(0),
+		_busyPollIntervalMillis(BUSY_POLL_MIN_MILLIS),
+		_busyTimeoutMillis(BUSY_TIMEOUT_DEFAULT_MILLIS),
+		_busyTimeoutRetries(BUSY_TIMEOUT_DEFAULT_RETRIES),
+		_refreshRetriesRemaining(0),
+		_resetPulseMillis(descriptor.resetPulseMillis),
+		_resetRecoveryMillis(descriptor.resetRecoveryMillis),
+		_refreshResult(REFRESH_RESULT_OK),
+		_powerState(POWER_STATE_UNKNOWN),
+		_powerPolicy(POWER_POLICY_ALWAYS_SLEEP),
+		_idleSleepMillis(0),
+		_idleSinceMillis(0),
+		_deviceImageValid(false),
+		_lut(descriptor.lut.bytes),
+		_lutSize(descriptor.lut.size),
+		_loadedLUT(nullptr),
+		_refreshMode(REFRESH_MODE_FULL),
+		_refreshFast(false),
+		_refreshInitializeOnly(false),
+		_refreshRegion(false),
+		_refreshCoversDirtyRect(false),
+		_skipUnchangedImage(true),
+		_shownImageHashValid(false),
+		_shownImageHash(0),
+		_shownImageFast(false),
+		_refreshImageHash(0),
+		_regionByteX0(0),
+		_regionByteX1(0),
+		_regionY0(0),
+		_regionY1(0)
+#if ePaper_REFRESH_STATS
+		,
+		_statsPhase(PHASE_COUNT),
+		_statsPlaneReturnPhase(PHASE_COUNT),
+		_statsPhaseStartMicros(0),
+		_statsRefreshStartMicros(0),
+		_statsBusyWaitStartMicros(0)
+#endif
 {
+#if ePaper_COMPILED_SEQUENCE_SLOTS
+	memset(_compiledSequences, 0, sizeof(_compiledSequences));
+#endif
 	pinMode(_deviceSelectPin, OUTPUT);
 	pinMode(_deviceResetPin, OUTPUT);
 	pinMode(_deviceDataCommandPin, OUTPUT);
@@ -71,6 +175,7 @@ ePaperDisplay::ePaperDisplay(
 	
 	SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
 	SPI.begin();
+	attachBusyInterrupt();
 	
 	DEBUG_PRINTLN(F("ePaperDisplay object constructed"));
 	DEBUG_PRINT(F("_deviceReadyPin = "));
@@ -96,39 +201,163 @@ ePaperDisplay::ePaperDisplay(
 	} else {
 		DEBUG_PRINTLN(F("FAIL - getBuffer2 malloc"));
 	}
-	_waitCallbackFunc = nullptr;
 }
 
 ePaperDisplay::~ePaperDisplay()
 {
+	if (_busyInterruptSlot >= 0) {
+		detachInterrupt(digitalPinToInterrupt(_deviceReadyPin));
+		busyInterruptOwners[_busyInterruptSlot] = nullptr;
+	}
+#if ePaper_COMPILED_SEQUENCE_SLOTS
+	for (uint8_t i = 0; i < ePaper_COMPILED_SEQUENCE_SLOTS; i++) {
+		if (_compiledSequences[i].ops) {
+			free(_compiledSequences[i].ops);
+		}
+	}
+#endif
+}
+
+void ISR_ATTR ePaperDisplay::busyInterruptSlot0(void)
+{
+	if (busyInterruptOwners[0]) busyInterruptOwners[0]->busyPinReleased();
 }
 
-void ePaperDisplay::waitForReady(void) const
+void ISR_ATTR ePaperDisplay::busyInterruptSlot1(void)
 {
-	uint8_t busyValue = ePaperDeviceConfigurations::deviceBusyValue(model());
-	
-	DEBUG_PRINT(F("Waiting until epaper device is complete with busy value = "));
-	DEBUG_PRINT(busyValue);
-	DEBUG_PRINT(F(" : ."));
-	
-// 	uint8_t cmd = 0x71;
-// 	sendCommand(cmd);
-	while (busyValue == digitalRead(_deviceReadyPin)) {
-		yield();
-		if (_waitCallbackFunc) _waitCallbackFunc();
-		DEBUG_PRINT(".");
-		sendCommand(0x71);
+	if (busyInterruptOwners[1]) busyInterruptOwners[1]->busyPinReleased();
+}
+
+void ISR_ATTR ePaperDisplay::busyPinReleased(void)
+{
+	_busyReleasedMillis = millis();
+	_busyReleased = true;
+}
+
+void ePaperDisplay::attachBusyInterrupt(void)
+{
+	int interruptNumber = digitalPinToInterrupt(_deviceReadyPin);
+	if (interruptNumber == NOT_AN_INTERRUPT) {
+		DEBUG_PRINTLN(F("BUSY pin has no interrupt. Will poll it."));
+		return;
 	}
-	DEBUG_PRINT(F("  Done!\n"));
+	for (int8_t i = 0; i < 2; i++) {
+		if (busyInterruptOwners[i] == nullptr) {
+			busyInterruptOwners[i] = this;
+			_busyInterruptSlot = i;
+			attachInterrupt(
+				interruptNumber,
+				(i == 0) ? busyInterruptSlot0 : busyInterruptSlot1,
+				(_descriptor.busyValue == LOW) ? RISING : FALLING
+			);
+			DEBUG_PRINTLN(F("BUSY pin serviced by interrupt."));
+			return;
+		}
+	}
+	DEBUG_PRINTLN(F("No free BUSY interrupt slot. Will poll BUSY pin."));
 }
 
-void ePaperDisplay::resetDriver(void) const
+bool ePaperDisplay::isDeviceBusy(void) const
 {
-	DEBUG_PRINTLN(F("reset driver"));
-	digitalWrite(_deviceResetPin, LOW);
-	delay(200);
-	digitalWrite(_deviceResetPin, HIGH);
-	delay(200);
+	return (_descriptor.busyValue == digitalRead(_deviceReadyPin));
+}
+
+void ePaperDisplay::startDelay( uint16_t delayMillis )
+{
+	_delayStartMillis = millis();
+	_delayMillis = delayMillis;
+}
+
+/*!
+    @brief  Starts waiting for the device to signal it is no longer busy.
+    @note   The BUSY pin is checked right away, so an edge that happened before the
+    		wait started is not missed.
+*/
+void ePaperDisplay::startBusyWait(void)
+{
+	_busyReleased = false;
+	_busyWaitStartMillis = millis();
+	_busyNextPollMillis = _busyWaitStartMillis;
+	_busyPollIntervalMillis = BUSY_POLL_MIN_MILLIS;
+	_sequenceWaitingForReady = true;
+	REFRESH_STATS(_statsBusyWaitStartMicros = micros());
+}
+
+/*!
+    @brief  Checks on a wait started with startBusyWait().
+    @return SEQUENCE_WAITING while the device is busy, SEQUENCE_ADVANCED once it is ready,
+    		or SEQUENCE_TIMEOUT if it has been busy for longer than the busy timeout.
+    @note   When the BUSY pin has an interrupt, the edge is recorded by the interrupt
+    		and the pin is only read occasionally as a safety net. Otherwise the pin is
+    		read with an interval that doubles up to BUSY_POLL_MAX_MILLIS, sending the
+    		get status command (0x71) with each read as the controllers' sample code does.
+*/
+ePaperDisplay::SequenceStatus ePaperDisplay::checkBusyWait(void)
+{
+	unsigned long now = millis();
+	if (_busyReleased) {
+		_sequenceWaitingForReady = false;
+		REFRESH_STATS(_stats.busyWaitMicros += micros() - _statsBusyWaitStartMicros);
+		return SEQUENCE_ADVANCED;
+	}
+	if ((long)(now - _busyNextPollMillis) >= 0) {
+		REFRESH_STATS(_stats.busyPolls++);
+		if (!isDeviceBusy()) {
+			_busyReleasedMillis = now;
+			_sequenceWaitingForReady = false;
+			REFRESH_STATS(_stats.busyWaitMicros += micros() - _statsBusyWaitStartMicros);
+			return SEQUENCE_ADVANCED;
+		}
+		if (usesBusyInterrupt()) {
+			_busyPollIntervalMillis = BUSY_POLL_MAX_MILLIS;
+		} else {
+			DEBUG_PRINT(".");
+			sendCommand(0x71);
+			if (_busyPollIntervalMillis < BUSY_POLL_MAX_MILLIS) {
+				_busyPollIntervalMillis *= 2;
+			}
+		}
+		_busyNextPollMillis = now + _busyPollIntervalMillis;
+	}
+	if ((_busyTimeoutMillis > 0) && ((now - _busyWaitStartMillis) >= _busyTimeoutMillis)) {
+		DEBUG_PRINTLN(F("  Timed out waiting for device!"));
+		_sequenceWaitingForReady = false;
+		REFRESH_STATS(_stats.busyWaitMicros += micros() - _statsBusyWaitStartMicros);
+		return SEQUENCE_TIMEOUT;
+	}
+	return SEQUENCE_WAITING;
+}
+
+bool ePaperDisplay::isDelayPending(void)
+{
+	if (_delayMillis == 0) {
+		return false;
+	}
+	if ((millis() - _delayStartMillis) < _delayMillis) {
+		return true;
+	}
+	_delayMillis = 0;
+	return false;
+}
+
+/*!
+    @brief  Sets the D/C pin and tells the transport of it.
+    @param	isData	true for data bytes, false for a command byte.
+*/
+void ePaperDisplay::setDataMode( bool isData ) const
+{
+	digitalWrite(_deviceDataCommandPin, isData ? HIGH : LOW);
+	_transport->setDataMode(isData);
+}
+
+/*!
+    @brief  Sets the CS pin, which is active low, and tells the transport of it.
+    @param	selected	true to select the device before a frame, false after it.
+*/
+void ePaperDisplay::selectDevice( bool selected ) const
+{
+	digitalWrite(_deviceSelectPin, selected ? LOW : HIGH);
+	_transport->setSelected(selected);
 }
 
 void ePaperDisplay::sendCommand( uint8_t cmd ) const
@@ -138,32 +367,217 @@ void ePaperDisplay::sendCommand( uint8_t cmd ) const
 		DEBUG_PRINTFORMAT(cmd, HEX);
 		DEBUG_PRINT(F("\n"));
 	}
-	digitalWrite(_deviceDataCommandPin, LOW);
-	digitalWrite(_deviceSelectPin, LOW);
-	SPI.transfer(cmd);
-	digitalWrite(_deviceSelectPin, HIGH);
+	REFRESH_STATS(_stats.commandBytes++);
+	setDataMode(false);
+	selectDevice(true);
+	_transport->write(&cmd, 1);
+	selectDevice(false);
 }
 
-void ePaperDisplay::sendData( const uint8_t *dataArray, uint16_t arraySize, bool isProgMem, bool invertBits ) const
+/*!
+    @brief  Sends a block of data bytes to the device.
+    @param	dataArray	the bytes to send.
+    @param	arraySize	the number of bytes to send.
+    @param	isProgMem	indicates whether dataArray resides in PROGMEM or not.
+    @param	invertBits	when true, every byte is bit-inverted before being sent.
+    @return None (void).
+    @note   The device's chip select is held low for the whole block.
+*/
+void ePaperDisplay::sendData( const uint8_t *dataArray, uint32_t arraySize, bool isProgMem, bool invertBits ) const
 {
 	DEBUG_PRINTLN(F("Sending data to device..."));
-	digitalWrite(_deviceDataCommandPin, HIGH);
-	for (uint16_t i = 0; i < arraySize; i++ ) {
-		digitalWrite(_deviceSelectPin, LOW);
-		uint8_t data;
+	setDataMode(true);
+	selectDevice(true);
+	writeData(dataArray, arraySize, isProgMem, invertBits);
+	selectDevice(false);
+	DEBUG_PRINTLN(F("    Done sending data to device."));
+}
+
+/*!
+    @brief  Sends a command followed by its data bytes in a single chip select frame.
+    @param	cmd			the command to send.
+    @param	dataArray	the data bytes to send after the command.
+    @param	arraySize	the number of data bytes to send. may be 0.
+    @param	isProgMem	indicates whether dataArray resides in PROGMEM or not.
+    @return None (void).
+*/
+void ePaperDisplay::sendCommandWithData( uint8_t cmd, const uint8_t *dataArray, uint32_t arraySize, bool isProgMem ) const
+{
+	DEBUG_PRINT(F("Sending command with data to device: 0x"));
+	DEBUG_PRINTFORMAT(cmd, HEX);
+	DEBUG_PRINT(F("\n"));
+	REFRESH_STATS(_stats.commandBytes++);
+	REFRESH_STATS(_stats.dataBytes += arraySize);
+	setDataMode(false);
+	selectDevice(true);
+	_transport->write(&cmd, 1);
+	if (arraySize > 0) {
+		setDataMode(true);
+		writeData(dataArray, arraySize, isProgMem, false);
+	}
+	selectDevice(false);
+}
+
+/*!
+    @brief  Writes data bytes to the transport. The caller frames them with the chip
+    		select and data/command pins.
+    @note   Bytes that need copying out of PROGMEM or inverting are staged through a 
+    		ePaper_SPI_CHUNK_SIZE scratch buffer, which is where the inversion is
+    		applied, and sent with a single SPI buffer transfer per chunk. The source
+    		array is never modified.
+*/
+void ePaperDisplay::writeData( const uint8_t *dataArray, uint32_t arraySize, bool isProgMem, bool invertBits ) const
+{
+	if (!isProgMem && !invertBits) {
+		// can be sent as is
+		_transport->write(dataArray, arraySize);
+		return;
+	}
+
+	// word aligned so inversion can be done 32 bits at a time
+	uint32_t chunkWords[ePaper_SPI_CHUNK_SIZE/4];
+	uint8_t *chunk = (uint8_t *)chunkWords;
+
+	uint32_t index = 0;
+	while (index < arraySize) {
+		uint16_t chunkSize = ePaper_SPI_CHUNK_SIZE;
+		if (arraySize - index < ePaper_SPI_CHUNK_SIZE) {
+			chunkSize = arraySize - index;
+		}
 		if (isProgMem) {
-			data = pgm_read_byte(&dataArray[i]);
+			memcpy_P(chunk, &dataArray[index], chunkSize);
 		} else {
-			data = dataArray[i];
-			if (invertBits) {
-				data = ~data;
+			memcpy(chunk, &dataArray[index], chunkSize);
+		}
+		if (invertBits) {
+			for (uint16_t i = 0; i < (chunkSize+3)/4; i++) {
+				chunkWords[i] = ~chunkWords[i];
 			}
 		}
-		SPI.transfer(data);
-		digitalWrite(_deviceSelectPin, HIGH);
+		_transport->write(chunk, chunkSize);
+		index += chunkSize;
+		ePaperYield::yieldIfDue();
+	}
+}
+
+static void invertBufferBits( uint8_t *buffer, uint32_t size )
+{
+	// canvas buffers come from malloc() and so are word aligned
+	uint32_t *words = (uint32_t *)buffer;
+	uint32_t wordCount = size/4;
+	for (uint32_t i = 0; i < wordCount; i++) {
+		words[i] = ~words[i];
+	}
+	for (uint32_t i = wordCount*4; i < size; i++) {
+		buffer[i] = ~buffer[i];
+	}
+}
+
+/*!
+    @brief  Starts sending an image plane to the device.
+    @param	plane		the canvas plane to send.
+    @param	invertBits	indicates whether the device expects the plane's bits inverted.
+    @return None (void).
+    @note   If the transport supports asynchronous transfers, this returns as soon as the
+    		transfer has started and the plane must not be touched until
+    		isTransferInProgress() returns false. Planes needing inversion are inverted in
+    		place for the duration of the transfer and restored afterwards. Otherwise the
+    		plane is sent before this returns. Either way the transfer complete call back
+    		function is called once the plane has been sent. Planes that the canvas
+    		rotates on sending are always sent before this returns.
+*/
+void ePaperDisplay::startPlaneTransfer( uint8_t *plane, bool invertBits )
+{
+	waitForTransferComplete();
+	if (plane == nullptr) {
+		// device does not have this plane
+		return;
+	}
+#if ePaper_REFRESH_STATS
+	_statsPlaneReturnPhase = _statsPhase;
+	setStatsPhase(plane == this->getBuffer1() ? PHASE_BLACK_PLANE : PHASE_COLOR_PLANE);
+	_stats.planeBytes += isRotatedOnSend() ? (uint32_t)WIDTH/8*HEIGHT : this->getBufferrSize();
+#endif
+	if (isRotatedOnSend()) {
+		sendDeviceRows(plane, 0, HEIGHT - 1, 0, WIDTH/8, invertBits);
+		REFRESH_STATS(setStatsPhase(_statsPlaneReturnPhase));
+		if (_transferCompleteCallbackFunc) _transferCompleteCallbackFunc();
+		return;
+	}
+	if (!_transport->supportsAsync()) {
+		sendData(plane, this->getBufferrSize(), false, invertBits);
+		REFRESH_STATS(setStatsPhase(_statsPlaneReturnPhase));
+		if (_transferCompleteCallbackFunc) _transferCompleteCallbackFunc();
+		return;
+	}
+
+	if (invertBits) {
+		invertBufferBits(plane, this->getBufferrSize());
+	}
+	_transferPlane = plane;
+	_transferPlaneInverted = invertBits;
+	setDataMode(true);
+	selectDevice(true);
+	_transport->writeAsync(plane, this->getBufferrSize());
+	isTransferInProgress();
+}
+
+/*!
+    @brief  Sends an image plane for a sequence's plane directive, unless the device
+    		still has it.
+    @param	plane		the canvas plane to send.
+    @param	invertBits	indicates whether the device expects the plane's bits inverted.
+    @return None (void).
+    @note   The device keeps the planes sent to it in RAM while it stays powered, so
+    		a plane not drawn to since it was last sent is skipped. The command 
+    		selecting the plane's RAM has been sent already and is then left without
+    		data, which leaves the RAM as it is. A fast refresh sends the black plane
+    		as the new data instead, overwriting what the device had.
+*/
+void ePaperDisplay::sendImagePlane( uint8_t *plane, bool invertBits )
+{
+	if (plane != nullptr) {
+		if (_refreshFast) {
+			markPlanesModified();
+		} else if (!isPlaneModified(plane)) {
+			DEBUG_PRINTLN(F("Device already has the image plane. Skipping it."));
+			return;
+		} else {
+			clearPlaneModified(plane);
+		}
+	}
+	startPlaneTransfer(plane, invertBits);
+}
+
+/*!
+    @brief  Checks on and, once done, completes any asynchronous plane transfer.
+    @return true if a plane transfer is still in progress.
+*/
+bool ePaperDisplay::isTransferInProgress(void)
+{
+	if (_transferPlane == nullptr) {
+		return false;
+	}
+	if (_transport->isBusy()) {
+		return true;
+	}
+	selectDevice(false);
+	if (_transferPlaneInverted) {
+		invertBufferBits(_transferPlane, this->getBufferrSize());
+	}
+	_transferPlane = nullptr;
+	REFRESH_STATS(setStatsPhase(_statsPlaneReturnPhase));
+	DEBUG_PRINTLN(F("Plane transfer complete."));
+	if (_transferCompleteCallbackFunc) _transferCompleteCallbackFunc();
+	return false;
+}
+
+void ePaperDisplay::waitForTransferComplete(void)
+{
+	while (isTransferInProgress()) {
 		yield();
+		if (_waitCallbackFunc) _waitCallbackFunc();
 	}
-	DEBUG_PRINTLN(F("    Done sending data to device."));
 }
 
 /****************************
@@ -177,12 +591,17 @@ void ePaperDisplay::sendData( const uint8_t *dataArray, uint16_t arraySize, bool
 					further bytes are consumed.
 			0xFE - Delay X milliseconds. The next bye is the number of millisecond (up to 255)
 			0xFD - Send B&W image - Sends B&W image to device from current buffer. No
-					further bytes are consumed.
+					further bytes are consumed. The transfer may continue in the background,
+					in which case the next directive waits for it to finish. Skipped if
+					the device still has the plane, see sendImagePlane().
 			0xFC - Send color image - Sends color image to devices that support it from
 					current buffer. Ignored if device does not support color image. No
-					further bytes are consumed.
-			0xFB -	Reserved
-			0xFA -	Reserved
+					further bytes are consumed. May continue in the background or be 
+					skipped like 0xFD.
+			0xFB -	Phase marker - The next byte is the ePaperRefreshPhase that the following
+					directives belong to. Only used for refresh statistics.
+			0xFA -	Power state marker - The next byte is the ePaperPowerState the device is
+					in after the preceding directives.
 			0xF9 -	Reserved
 			0xF8 -	Reserved
 			0xF7 -	Reserved
@@ -199,86 +618,1057 @@ void ePaperDisplay::sendData( const uint8_t *dataArray, uint16_t arraySize, bool
 					Note that any directive value not defined above is always interpreted
 					as an N value.
 
+	The sequences are declared with ePaperCommandSequence, which emits this byte code
+	and counts the data block lengths at compile time. See ePaperSequence.h.
 */
-void ePaperDisplay::sendCommandAndDataSequenceFromProgMem( const uint8_t *dataArray, uint16_t arraySize) const
+void ePaperDisplay::sendCommandAndDataSequenceFromProgMem( const uint8_t *dataArray, uint16_t arraySize)
 {
-	uint16_t index = 0;
-	
-	while (index < arraySize) {
-		// read byte
-		uint8_t b = pgm_read_byte(&dataArray[index]);
-		if (b == 0x00) {
-			// send next byte as command
-			index++;
-			sendCommand(pgm_read_byte(&dataArray[index]));
-			index++;
-		} else if (b == 0xFF ) {
-			waitForReady();
-			index++;
-		} else if (b == 0xFE) {
-			index++;
-			uint8_t delay_millis = pgm_read_byte(&dataArray[index]);
+	if (_refreshState != REFRESH_IDLE) {
+		// the refresh in progress is running its own sequence
+		DEBUG_PRINTLN(F("Cannot send a sequence during a refresh."));
+		return;
+	}
+	beginSequence(dataArray, arraySize);
+	runSequenceToCompletion();
+}
+
+void ePaperDisplay::beginSequence( const uint8_t *dataArray, uint16_t arraySize)
+{
+	_sequence = dataArray;
+	_sequenceOps = nullptr;
+	_sequenceSize = arraySize;
+	_sequenceIndex = 0;
+	_sequenceWaitingForReady = false;
+#if ePaper_COMPILED_SEQUENCE_SLOTS
+	const CompiledSequence *compiled = findCompiledSequence(dataArray, arraySize);
+	if (compiled) {
+		_sequenceOps = compiled->ops;
+		_sequenceSize = compiled->opCount;
+	}
+#endif
+}
+
+#if ePaper_COMPILED_SEQUENCE_SLOTS
+/*!
+    @brief  Finds the compiled form of a command sequence, compiling it if this is the
+    		first time it is used.
+    @return the compiled sequence, or nullptr if there is no free slot or not enough
+    		memory, in which case the sequence is interpreted from PROGMEM. A sequence is
+    		also interpreted if its slot was compiled for a different size.
+*/
+const ePaperDisplay::CompiledSequence *ePaperDisplay::findCompiledSequence( const uint8_t *dataArray, uint16_t arraySize )
+{
+	if ((dataArray == nullptr)||(arraySize == 0)) {
+		return nullptr;
+	}
+	for (uint8_t i = 0; i < ePaper_COMPILED_SEQUENCE_SLOTS; i++) {
+		CompiledSequence& slot = _compiledSequences[i];
+		if (slot.sequence == dataArray) {
+			// a different length of the same bytes is interpreted instead
+			return (slot.sequenceSize == arraySize) ? &slot : nullptr;
+		}
+		if (slot.sequence == nullptr) {
+			uint8_t opCount = 0;
+			SequenceOp *ops = compileSequence(dataArray, arraySize, opCount);
+			if (ops == nullptr) {
+				return nullptr;
+			}
+			slot.sequence = dataArray;
+			slot.sequenceSize = arraySize;
+			slot.ops = ops;
+			slot.opCount = opCount;
+			return &slot;
+		}
+	}
+	return nullptr;
+}
+
+/*!
+    @brief  Decodes a command sequence into a list of operations.
+    @param	dataArray	the sequence in PROGMEM.
+    @param	arraySize	the size of the sequence.
+    @param	opCount		set to the number of operations.
+    @return the operations, allocated with malloc(), or nullptr if out of memory.
+    @note   A command and the data block following it become one operation, which is
+    		sent in a single chip select frame. Consecutive waits for ready are merged,
+    		as are consecutive delays. The data itself stays in PROGMEM.
+*/
+ePaperDisplay::SequenceOp *ePaperDisplay::compileSequence( const uint8_t *dataArray, uint16_t arraySize, uint8_t& opCount )
+{
+	// the first pass counts the operations, the second fills them in
+	SequenceOp *ops = nullptr;
+	for (uint8_t pass = 0; pass < 2; pass++) {
+		uint16_t count = 0;
+		uint16_t index = 0;
+		SequenceOp pending = { 0, 0, 0, 0 };
+		bool hasPending = false;
+		while (index < arraySize) {
+			uint8_t b = pgm_read_byte(&dataArray[index]);
+			SequenceOp op = { b, 0, 0, 0 };
+			if ((b == 0x00)||(b == 0xFE)||(b == 0xFB)||(b == 0xFA)) {
+				op.value = pgm_read_byte(&dataArray[index + 1]);
+				if (b == 0xFE) {
+					op.dataSize = op.value;
+				}
+				index += 2;
+			} else if (b < 0xF0) {
+				op.directive = SEQUENCE_OP_DATA;
+				op.dataIndex = index + 1;
+				op.dataSize = b;
+				index += b + 1;
+			} else {
+				index++;
+			}
+
+			if (hasPending && mergeSequenceOps(pending, op)) {
+				continue;
+			}
+			if (hasPending) {
+				if (ops) ops[count] = pending;
+				count++;
+			}
+			pending = op;
+			hasPending = true;
+		}
+		if (hasPending) {
+			if (ops) ops[count] = pending;
+			count++;
+		}
+		if ((count == 0)||(count > 0xFF)) {
+			return nullptr;
+		}
+		if (pass == 0) {
+			ops = (SequenceOp *)malloc(count*sizeof(SequenceOp));
+			if (ops == nullptr) {
+				return nullptr;
+			}
+		}
+		opCount = count;
+	}
+	return ops;
+}
+
+/*!
+    @brief  Folds an operation into the one before it, if they can be combined.
+    @return true if op was merged into prior.
+*/
+bool ePaperDisplay::mergeSequenceOps( SequenceOp& prior, const SequenceOp& op )
+{
+	if ((op.directive == SEQUENCE_OP_DATA)&&(prior.directive == 0x00)&&(prior.dataSize == 0)) {
+		// the command's data
+		prior.dataIndex = op.dataIndex;
+		prior.dataSize = op.dataSize;
+		return true;
+	}
+	if ((op.directive == 0xFF)&&(prior.directive == 0xFF)) {
+		return true;
+	}
+	if ((op.directive == 0xFE)&&(prior.directive == 0xFE)) {
+		prior.dataSize += op.dataSize;
+		return true;
+	}
+	return false;
+}
+#endif
+
+/*!
+    @brief  Executes the next directive of the current command sequence, unless the
+    		sequence is waiting on the device.
+    @return SEQUENCE_ADVANCED if a directive was executed, SEQUENCE_WAITING if a plane
+    		transfer, delay or the device's busy state is holding up the sequence,
+    		SEQUENCE_TIMEOUT if the device stayed busy past the busy timeout, or
+    		SEQUENCE_DONE if all directives have been executed. Never blocks other than
+    		for the time it takes to send a command or data block.
+*/
+ePaperDisplay::SequenceStatus ePaperDisplay::stepSequence(void)
+{
+	// a plane may still be on its way to the device
+	if (isTransferInProgress()) {
+		return SEQUENCE_WAITING;
+	}
+	if (isDelayPending()) {
+		return SEQUENCE_WAITING;
+	}
+	if (_sequenceWaitingForReady) {
+		SequenceStatus busyStatus = checkBusyWait();
+		if (busyStatus != SEQUENCE_ADVANCED) {
+			return busyStatus;
+		}
+		DEBUG_PRINT(F("  Done!\n"));
+	}
+	if (_sequenceIndex >= _sequenceSize) {
+		return SEQUENCE_DONE;
+	}
+	if (_sequenceOps) {
+		executeSequenceOp(_sequenceOps[_sequenceIndex]);
+		_sequenceIndex++;
+	} else {
+		executeSequenceByteCode();
+	}
+	return SEQUENCE_ADVANCED;
+}
+
+void ePaperDisplay::executeSequenceOp( const SequenceOp& op )
+{
+	switch (op.directive) {
+		case 0x00:
+			sendCommandWithData(op.value, &_sequence[op.dataIndex], op.dataSize, true);
+			break;
+		case SEQUENCE_OP_DATA:
+			REFRESH_STATS(_stats.dataBytes += op.dataSize);
+			sendData(&_sequence[op.dataIndex], op.dataSize, true);
+			break;
+		case 0xFF:
+			DEBUG_PRINT(F("Waiting until epaper device is complete : ."));
+			startBusyWait();
+			break;
+		case 0xFE:
 			DEBUG_PRINT(F("Delaying for "));
-			DEBUG_PRINT(delay_millis);
+			DEBUG_PRINT(op.dataSize);
 			DEBUG_PRINT(F(" milliseconds\n"));
-			delay(delay_millis);
-			index++;
-		} else if (b == 0xFD ) {
-			sendData(
-				this->getBuffer1(),
-				this->getBufferrSize(),
-				false,
-				ePaperDeviceConfigurations::deviceUsesInvertedBlackBits(this->model())
+			startDelay(op.dataSize);
+			break;
+		case 0xFD:
+			sendImagePlane(
+				this->getWritableBuffer1(),
+				_descriptor.invertedBlackBits
 			);
-			index++;
-		} else if (b == 0xFC ) {
-			sendData(
-				this->getBuffer2(),
-				this->getBufferrSize(),
-				false,
-				ePaperDeviceConfigurations::deviceUsesInvertedColorBits(this->model())
-			);		
-			index++;
-		} else if (b < (uint16_t)0xF0) {
-			// b is and array length. send the next b bytes as dataArray
-			index++;
-			sendData(&dataArray[index], b, true);
-			index += b;
+			break;
+		case 0xFC:
+			sendImagePlane(
+				this->getWritableBuffer2(),
+				_descriptor.invertedColorBits
+			);
+			break;
+		case 0xFB:
+			REFRESH_STATS(setStatsPhase((ePaperRefreshPhase)op.value));
+			break;
+		case 0xFA:
+			_powerState = (ePaperPowerState)op.value;
+			break;
+		default:
+			// reserved directive
+			break;
+	}
+}
+
+void ePaperDisplay::executeSequenceByteCode(void)
+{
+	// read byte
+	uint8_t b = pgm_read_byte(&_sequence[_sequenceIndex]);
+	if (b == 0x00) {
+		// send next byte as command
+		_sequenceIndex++;
+		sendCommand(pgm_read_byte(&_sequence[_sequenceIndex]));
+		_sequenceIndex++;
+	} else if (b == 0xFF ) {
+		DEBUG_PRINT(F("Waiting until epaper device is complete : ."));
+		startBusyWait();
+		_sequenceIndex++;
+	} else if (b == 0xFE) {
+		_sequenceIndex++;
+		uint8_t delay_millis = pgm_read_byte(&_sequence[_sequenceIndex]);
+		DEBUG_PRINT(F("Delaying for "));
+		DEBUG_PRINT(delay_millis);
+		DEBUG_PRINT(F(" milliseconds\n"));
+		startDelay(delay_millis);
+		_sequenceIndex++;
+	} else if (b == 0xFD ) {
+		sendImagePlane(
+			this->getWritableBuffer1(),
+			_descriptor.invertedBlackBits
+		);
+		_sequenceIndex++;
+	} else if (b == 0xFC ) {
+		sendImagePlane(
+			this->getWritableBuffer2(),
+			_descriptor.invertedColorBits
+		);		
+		_sequenceIndex++;
+	} else if (b == 0xFB ) {
+		// phase marker
+		_sequenceIndex++;
+		REFRESH_STATS(setStatsPhase((ePaperRefreshPhase)pgm_read_byte(&_sequence[_sequenceIndex])));
+		_sequenceIndex++;
+	} else if (b == 0xFA ) {
+		// power state marker
+		_sequenceIndex++;
+		_powerState = (ePaperPowerState)pgm_read_byte(&_sequence[_sequenceIndex]);
+		_sequenceIndex++;
+	} else if (b < (uint16_t)0xF0) {
+		// b is and array length. send the next b bytes as dataArray
+		_sequenceIndex++;
+		REFRESH_STATS(_stats.dataBytes += b);
+		sendData(&_sequence[_sequenceIndex], b, true);
+		_sequenceIndex += b;
+	} else {
+		// reserved directive
+		_sequenceIndex++;
+	}
+}
+
+void ePaperDisplay::runSequenceToCompletion(void)
+{
+	SequenceStatus status;
+	while ((status = stepSequence()) != SEQUENCE_DONE) {
+		if (status == SEQUENCE_TIMEOUT) {
+			// abandon the rest of the sequence
+			return;
 		}
 		yield();
+		if ((status == SEQUENCE_WAITING) && _waitCallbackFunc) {
+			_waitCallbackFunc();
+		}
 	}
-
 }
 
-void ePaperDisplay::initializeDevice(void) const
+/*!
+    @brief  Resets the device and sends it the configuration, without refreshing it.
+    @return REFRESH_RESULT_OK, or REFRESH_RESULT_BUSY_TIMEOUT if the device never
+    		became ready.
+    @note   Finishes any refresh in progress first. Does not return until the device
+    		is configured.
+*/
+ePaperRefreshResult ePaperDisplay::initializeDevice(void)
 {
+	while (isBusy()) {
+		poll();
+		yield();
+	}
 	DEBUG_PRINTLN(F("powering up device"));
+	_refreshRetriesRemaining = _busyTimeoutRetries;
+	_refreshResult = REFRESH_RESULT_OK;
+	_refreshInitializeOnly = true;
+	REFRESH_STATS(startStats());
+	startResetPulse();
+	return runRefreshToCompletion();
+}
+
+/*!
+    @brief  Starts pushing the current image buffer contents to the ePaper device
+    		without waiting for the device.
+    @return true if the refresh was started, false if a refresh is already in progress.
+    @note   Call poll() repeatedly until it returns false to carry the refresh through.
+    		The image buffer must not be drawn to until the refresh has completed.
+    		The hardware reset is only done if the device is in an unknown state or
+    		deep sleep, and the configuration is only sent after a hardware reset.
+    		Nothing is sent if the image is unchanged, see setSkipUnchangedImage().
+*/
+bool ePaperDisplay::beginRefresh(void)
+{
+	if (_refreshState != REFRESH_IDLE) {
+		return false;
+	}
+	if (isImageShown()) {
+		return true;
+	}
+	_refreshRegion = false;
+	_refreshCoversDirtyRect = true;
+	startRefresh();
+	return true;
+}
+
+/*!
+    @brief  Checks whether the image buffer holds the image last sent by a full or
+    		changes refresh, in which case the refresh is skipped. It is not skipped 
+    		if the image would now be driven with the other waveform, so that a full
+    		refresh can clean up the ghosting left by fast ones.
+    @return true if the refresh should be skipped.
+    @note   Also notes the image's hash, to be recorded once the refresh completes.
+*/
+bool ePaperDisplay::isImageShown(void)
+{
+	if (!_skipUnchangedImage) {
+		return false;
+	}
+	_refreshImageHash = getImageHash();
+	if (_shownImageHashValid && (_refreshImageHash == _shownImageHash)
+		&& (_shownImageFast == usesFastRefresh())
+	) {
+		DEBUG_PRINTLN(F("Image buffer unchanged. Skipping refresh."));
+		clearDirtyRect();
+		_refreshResult = REFRESH_RESULT_SKIPPED;
+		return true;
+	}
+	return false;
+}
+
+/*!
+    @brief  Starts pushing the part of the image buffer within a rectangle to the
+    		ePaper device without waiting for the device.
+    @param	x	left edge of the rectangle in the current rotation.
+    @param	y	top edge of the rectangle in the current rotation.
+    @param	w	width of the rectangle.
+    @param	h	height of the rectangle.
+    @return true if the refresh was started, false if a refresh is already in progress.
+    @note   Call poll() repeatedly until it returns false, as with beginRefresh(). Does 
+    		a full refresh if the device cannot do a partial one, see refreshRegion().
+*/
+bool ePaperDisplay::beginRefreshRegion( int16_t x, int16_t y, int16_t w, int16_t h )
+{
+	if (_refreshState != REFRESH_IDLE) {
+		return false;
+	}
+	if (!mapToDeviceRect(x, y, w, h)) {
+		DEBUG_PRINTLN(F("Refresh region is off screen. Nothing to do."));
+		_refreshResult = REFRESH_RESULT_SKIPPED;
+		return true;
+	}
+	_refreshCoversDirtyRect = false;
+	// parts of the buffer outside the region may differ from the screen
+	_shownImageHashValid = false;
+	startDeviceRegionRefresh(x, y, w, h);
+	return true;
+}
+
+/*!
+    @brief  Starts refreshing the area of the image buffer changed since the last
+    		full or changes refresh without waiting for the device.
+    @return true if the refresh was started or there was nothing to refresh, false 
+    		if a refresh is already in progress.
+    @note   Call poll() repeatedly until it returns false, as with beginRefresh().
+*/
+bool ePaperDisplay::beginRefreshChanges(void)
+{
+	if (_refreshState != REFRESH_IDLE) {
+		return false;
+	}
+	int16_t x, y, w, h;
+	if (!getDirtyRect(x, y, w, h)) {
+		DEBUG_PRINTLN(F("Image buffer unchanged. Nothing to refresh."));
+		_refreshResult = REFRESH_RESULT_SKIPPED;
+		return true;
+	}
+	if (isImageShown()) {
+		return true;
+	}
+	_refreshCoversDirtyRect = true;
+	startDeviceRegionRefresh(x, y, w, h);
+	return true;
+}
+
+/*!
+    @brief  Checks whether a refresh started now would use the fast waveform.
+*/
+bool ePaperDisplay::usesFastRefresh(void) const
+{
+	return (_refreshMode == REFRESH_MODE_FAST)
+			&& (_descriptor.setImageAndFastRefresh.bytes != nullptr)
+			&& hasOnlyBlackAndWhite();
+}
+
+/*!
+    @brief  Starts a refresh of a region given in the device's unrotated coordinates.
+*/
+void ePaperDisplay::startDeviceRegionRefresh( int16_t x, int16_t y, int16_t w, int16_t h )
+{
+	_regionByteX0 = x/8;
+	_regionByteX1 = (x + w - 1)/8;
+	_regionY0 = y;
+	_regionY1 = y + h - 1;
+	_refreshRegion = (_descriptor.partialWindowMode != PARTIAL_WINDOW_NONE)
+						&& ((w < WIDTH)||(h < HEIGHT));
+	startRefresh();
+}
+
+void ePaperDisplay::startRefresh(void)
+{
+	_refreshRetriesRemaining = _busyTimeoutRetries;
+	_refreshResult = REFRESH_RESULT_OK;
+	_refreshInitializeOnly = false;
+	_refreshFast = usesFastRefresh();
+	if (_powerState != POWER_STATE_POWERED) {
+		// only trust the device's RAM to still have the planes while it stays powered
+		markPlanesModified();
+	}
+	REFRESH_STATS(startStats());
+	switch (_powerState) {
+		case POWER_STATE_RESET:
+			startRefreshSequence(REFRESH_CONFIGURE, _descriptor.configuration.bytes, _descriptor.configuration.size);
+			break;
+		case POWER_STATE_INITIALIZED:
+			startRefreshSequence(
+				REFRESH_POWER_ON,
+				_descriptor.powerOn.bytes,
+				_descriptor.powerOn.size
+			);
+			break;
+		case POWER_STATE_POWERED:
+			startImageSequence();
+			break;
+		default:
+			startResetPulse();
+			break;
+	}
+}
+
+#if ePaper_REFRESH_STATS
+void ePaperDisplay::startStats(void)
+{
+	memset(&_stats, 0, sizeof(_stats));
+	_statsRefreshStartMicros = micros();
+	_statsPhase = PHASE_COUNT;
+}
+
+/*!
+    @brief  Closes out the time spent in the current refresh phase and starts timing
+    		the passed phase. Pass PHASE_COUNT to stop timing phases.
+*/
+void ePaperDisplay::setStatsPhase( ePaperRefreshPhase phase )
+{
+	unsigned long now = micros();
+	if (_statsPhase < PHASE_COUNT) {
+		_stats.phaseMicros[_statsPhase] += now - _statsPhaseStartMicros;
+	}
+	_statsPhase = phase;
+	_statsPhaseStartMicros = now;
+}
+
+void ePaperDisplay::finishStats(void)
+{
+	setStatsPhase(PHASE_COUNT);
+	_stats.totalMicros = micros() - _statsRefreshStartMicros;
+}
+#endif
+
+void ePaperDisplay::startResetPulse(void)
+{
 	DEBUG_PRINTLN(F("resetting driver"));
-	resetDriver();
-	DEBUG_PRINT(F("sending configuration with size = "));
-	DEBUG_PRINT(_configurationSize);
-	DEBUG_PRINT(F("\n"));
-	sendCommandAndDataSequenceFromProgMem(_configuration, _configurationSize);	
-	DEBUG_PRINTLN(F("done setting up device.\n"));
+	REFRESH_STATS(setStatsPhase(PHASE_RESET));
+	digitalWrite(_deviceResetPin, LOW);
+	startDelay(_resetPulseMillis);
+	_refreshState = REFRESH_RESET_LOW;
+	_deviceImageValid = false;
+	_loadedLUT = nullptr;
+	markPlanesModified();
+}
+
+void ePaperDisplay::startRefreshSequence( RefreshState state, const uint8_t *dataArray, uint16_t arraySize )
+{
+#if ePaper_REFRESH_STATS
+	switch (state) {
+		case REFRESH_LUT:
+			setStatsPhase(PHASE_LUT_UPLOAD);
+			break;
+		case REFRESH_IMAGE:
+			setStatsPhase(PHASE_IMAGE);
+			break;
+		default:
+			setStatsPhase(PHASE_CONFIGURATION);
+			break;
+	}
+#endif
+	beginSequence(dataArray, arraySize);
+	_refreshState = state;
+}
+
+void ePaperDisplay::startSleepSequence( RefreshState state )
+{
+	DEBUG_PRINTLN(F("Putting device to sleep."));
+	beginSequence(
+		_descriptor.sleep.bytes,
+		_descriptor.sleep.size
+	);
+	_refreshState = state;
 }
 
 /*!
-    @brief  Pushes the current image buffer contents to the ePaper device.
+    @brief  Starts sending the image, either the whole screen or just the refresh region,
+    		after uploading the waveform LUTs if the device does not have them.
+    @note   A refresh region is only used while the device still has the previous image,
+    		since the parts of the screen outside the region are left to it. A fast 
+    		refresh uses the device's black and white LUTs instead of the set ones, and
+    		a device that otherwise uses its OTP LUTs is switched back to them after one.
+*/
+void ePaperDisplay::startImageSequence(void)
+{
+	const uint8_t *lut = _lut;
+	uint16_t lutSize = _lutSize;
+	if (_refreshFast) {
+		lut = _descriptor.fastRefreshLUT.bytes;
+		lutSize = _descriptor.fastRefreshLUT.size;
+	} else if ((lut == nullptr)&&(_loadedLUT != nullptr)) {
+		// a fast refresh left the device using register LUTs
+		lut = _descriptor.otpLUT.bytes;
+		lutSize = _descriptor.otpLUT.size;
+	}
+	if ((lut != nullptr)&&(_loadedLUT != lut)) {
+		DEBUG_PRINTLN(F("Uploading waveform LUTs."));
+		startRefreshSequence(REFRESH_LUT, lut, lutSize);
+		return;
+	}
+	if (_refreshRegion && _deviceImageValid) {
+		DEBUG_PRINTLN(F("Sending refresh region."));
+		REFRESH_STATS(setStatsPhase(PHASE_IMAGE));
+		sendRegionImage();
+		startRefreshSequence(
+			REFRESH_IMAGE,
+			_descriptor.refreshRegion.bytes,
+			_descriptor.refreshRegion.size
+		);
+	} else if (_refreshFast) {
+		DEBUG_PRINTLN(F("Sending black image for a fast refresh."));
+		startRefreshSequence(
+			REFRESH_IMAGE,
+			_descriptor.setImageAndFastRefresh.bytes,
+			_descriptor.setImageAndFastRefresh.size
+		);
+	} else {
+		startRefreshSequence(
+			REFRESH_IMAGE,
+			_descriptor.setImageAndRefresh.bytes,
+			_descriptor.setImageAndRefresh.size
+		);
+	}
+}
+
+/*!
+    @brief  Sets the device's window to the refresh region and sends the image data
+    		within it.
+    @note   The window's rows are sent straight from the canvas planes, one data block
+    		per row, without the asynchronous transport. On UC81xx style controllers the
+    		device is left in partial mode, which the region's refresh sequence ends.
+*/
+void ePaperDisplay::sendRegionImage(void)
+{
+	uint8_t window[9];
+	uint8_t windowSize = 0;
+	ePaperPartialWindowMode mode = _descriptor.partialWindowMode;
+
+	switch (mode) {
+		case PARTIAL_WINDOW_UC81XX:
+		case PARTIAL_WINDOW_UC81XX_WIDE: {
+			// horizontal positions are in whole bytes, the end being the last bit of its byte
+			uint16_t x0 = _regionByteX0*8;
+			uint16_t x1 = _regionByteX1*8 + 7;
+			if (mode == PARTIAL_WINDOW_UC81XX_WIDE) {
+				window[windowSize++] = x0 >> 8;
+			}
+			window[windowSize++] = x0 & 0xFF;
+			if (mode == PARTIAL_WINDOW_UC81XX_WIDE) {
+				window[windowSize++] = x1 >> 8;
+			}
+			window[windowSize++] = x1 & 0xFF;
+			window[windowSize++] = _regionY0 >> 8;
+			window[windowSize++] = _regionY0 & 0xFF;
+			window[windowSize++] = _regionY1 >> 8;
+			window[windowSize++] = _regionY1 & 0xFF;
+			// gates scan both inside and outside of the window
+			window[windowSize++] = 0x01;
+
+			// partial in
+			sendCommand(0x91);
+			sendCommand(0x90);
+			REFRESH_STATS(_stats.dataBytes += windowSize);
+			sendData(window, windowSize, false);
+			if (_refreshFast) {
+				// the black and white waveform only looks at the new data
+				markPlanesModified();
+				sendCommand(0x13);
+				sendRegionPlane(
+					this->getBuffer1(),
+					_descriptor.invertedBlackBits
+				);
+				break;
+			}
+			sendCommand(0x10);
+			sendRegionPlane(
+				this->getBuffer1(),
+				_descriptor.invertedBlackBits
+			);
+			if (this->getBuffer2()) {
+				sendCommand(0x13);
+				sendRegionPlane(
+					this->getBuffer2(),
+					_descriptor.invertedColorBits
+				);
+			}
+			break;
+		}
+		case PARTIAL_WINDOW_SSD_RAM: {
+			// the RAM's Y address counts down from the bottom row, see the data entry mode
+			uint16_t ramY0 = HEIGHT - 1 - _regionY0;
+			uint16_t ramY1 = HEIGHT - 1 - _regionY1;
+
+			// RAMX Start/End
+			window[0] = _regionByteX0;
+			window[1] = _regionByteX1;
+			sendCommand(0x44);
+			sendData(window, 2, false);
+			
+			// RAMY Start/End
+			window[0] = ramY0 & 0xFF;
+			window[1] = ramY0 >> 8;
+			window[2] = ramY1 & 0xFF;
+			window[3] = ramY1 >> 8;
+			sendCommand(0x45);
+			sendData(window, 4, false);
+
+			// set RAMX address counter
+			window[0] = _regionByteX0;
+			sendCommand(0x4E);
+			sendData(window, 1, false);
+
+			// set RAMY address counter
+			window[0] = ramY0 & 0xFF;
+			window[1] = ramY0 >> 8;
+			sendCommand(0x4F);
+			sendData(window, 2, false);
+			REFRESH_STATS(_stats.dataBytes += 9);
+
+			sendCommand(0x24);
+			sendRegionPlane(
+				this->getBuffer1(),
+				_descriptor.invertedBlackBits
+			);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void ePaperDisplay::sendRegionPlane( const uint8_t *plane, bool invertBits )
+{
+	if (plane == nullptr) {
+		return;
+	}
+	uint16_t rowBytes = WIDTH/8;
+	uint16_t windowBytes = _regionByteX1 - _regionByteX0 + 1;
+#if ePaper_REFRESH_STATS
+	ePaperRefreshPhase returnPhase = _statsPhase;
+	setStatsPhase(plane == this->getBuffer1() ? PHASE_BLACK_PLANE : PHASE_COLOR_PLANE);
+	_stats.planeBytes += (uint32_t)windowBytes*(_regionY1 - _regionY0 + 1);
+#endif
+	if (isRotatedOnSend()) {
+		sendDeviceRows(plane, _regionY0, _regionY1, _regionByteX0, windowBytes, invertBits);
+	} else {
+		for (uint16_t row = _regionY0; row <= _regionY1; row++) {
+			sendData(&plane[(uint32_t)row*rowBytes + _regionByteX0], windowBytes, false, invertBits);
+		}
+	}
+	REFRESH_STATS(setStatsPhase(returnPhase));
+	if (_transferCompleteCallbackFunc) _transferCompleteCallbackFunc();
+}
+
+/*!
+    @brief  Sends bytes of device rows of a plane that the canvas rotates on sending,
+    		as one data transfer.
+    @param	plane		the canvas plane.
+    @param	row0, row1	the first and last device row.
+    @param	byteX		the first byte of each row.
+    @param	byteCount	the number of bytes of each row.
+    @param	invertBits	indicates whether the device expects the plane's bits inverted.
     @return None (void).
+    @note   The rows are read with getDeviceBytes() into a ePaper_SPI_CHUNK_SIZE scratch
+    		buffer, as writeData() stages bytes. At 90 and 270 degrees, up to 8 rows at a
+    		time are read with getDeviceRows() into a buffer allocated for the transfer,
+    		if there is memory for it.
+*/
+void ePaperDisplay::sendDeviceRows( 
+	const uint8_t *plane,
+	uint16_t row0,
+	uint16_t row1,
+	uint16_t byteX,
+	uint16_t byteCount,
+	bool invertBits
+)
+{
+	uint32_t chunkWords[ePaper_SPI_CHUNK_SIZE/4];
+	uint8_t *chunk = (uint8_t *)chunkWords;
+
+	setDataMode(true);
+	selectDevice(true);
+	uint8_t *rows = nullptr;
+	if (isTransposedOnSend() && (row1 > row0)) {
+		rows = (uint8_t *)malloc((uint32_t)8*byteCount);
+	}
+	if (rows != nullptr) {
+		uint16_t row = row0;
+		while (row <= row1) {
+			uint8_t rowCount = getDeviceRows(plane, row, row1, byteX, byteCount, rows);
+			uint32_t size = (uint32_t)rowCount*byteCount;
+			if (invertBits) {
+				invertBufferBits(rows, size);
+			}
+			_transport->write(rows, size);
+			row += rowCount;
+			ePaperYield::yieldIfDue();
+		}
+		free(rows);
+		selectDevice(false);
+		return;
+	}
+	for (uint16_t row = row0; row <= row1; row++) {
+		uint16_t index = 0;
+		while (index < byteCount) {
+			uint16_t chunkSize = ePaper_SPI_CHUNK_SIZE;
+			if (byteCount - index < ePaper_SPI_CHUNK_SIZE) {
+				chunkSize = byteCount - index;
+			}
+			getDeviceBytes(plane, row, byteX + index, chunkSize, chunk);
+			if (invertBits) {
+				for (uint16_t i = 0; i < (chunkSize+3)/4; i++) {
+					chunkWords[i] = ~chunkWords[i];
+				}
+			}
+			_transport->write(chunk, chunkSize);
+			index += chunkSize;
+			ePaperYield::yieldIfDue();
+		}
+	}
+	selectDevice(false);
+}
+
+void ePaperDisplay::finishRefreshSequence(void)
+{
+	switch (_refreshState) {
+		case REFRESH_CONFIGURE:
+			if (_powerState == POWER_STATE_RESET) {
+				_powerState = POWER_STATE_INITIALIZED;
+			}
+			if (_refreshInitializeOnly) {
+				DEBUG_PRINTLN(F("done setting up device.\n"));
+				_refreshState = REFRESH_IDLE;
+				REFRESH_STATS(finishStats());
+				break;
+			}
+			// fall through
+		case REFRESH_POWER_ON:
+			DEBUG_PRINTLN(F("Starting display refresh sequence."));
+			startImageSequence();
+			break;
+		case REFRESH_LUT:
+			_loadedLUT = _sequence;
+			startImageSequence();
+			break;
+		case REFRESH_IMAGE:
+			_deviceImageValid = true;
+			if (_refreshCoversDirtyRect) {
+				clearDirtyRect();
+				_shownImageHash = _refreshImageHash;
+				_shownImageFast = _refreshFast;
+				_shownImageHashValid = _skipUnchangedImage;
+			}
+			_idleSinceMillis = millis();
+			if (_powerPolicy == POWER_POLICY_ALWAYS_SLEEP) {
+				startSleepSequence(REFRESH_SLEEP);
+				break;
+			}
+			// fall through
+		case REFRESH_SLEEP:
+			DEBUG_PRINTLN(F("Display refresh complete."));
+			_refreshState = REFRESH_IDLE;
+			REFRESH_STATS(finishStats());
+			break;
+		default:
+			_refreshState = REFRESH_IDLE;
+			REFRESH_STATS(setStatsPhase(PHASE_COUNT));
+			break;
+	}
+}
+
+/*!
+    @brief  Advances a refresh started with beginRefresh().
+    @return true if the refresh is still in progress, false once it has completed.
+    @note   Executes as many steps of the refresh as it can without waiting on the
+    		device. It returns rather than waiting on the reset timing, a delay
+    		directive, a plane transfer or the device's busy pin. If the device stays
+    		busy past the busy timeout, the refresh is restarted from the hardware reset
+    		up to the configured number of retries. Check lastRefreshResult() once done.
+    		When idle, also puts the device to sleep as called for by the power policy,
+    		returning true while doing so.
+*/
+bool ePaperDisplay::poll(void)
+{
+	if ((_refreshState == REFRESH_IDLE)
+		&& (_powerPolicy == POWER_POLICY_SLEEP_WHEN_IDLE)
+		&& (_powerState != POWER_STATE_DEEP_SLEEP)
+		&& (_powerState != POWER_STATE_UNKNOWN)
+		&& ((millis() - _idleSinceMillis) >= _idleSleepMillis)
+	) {
+		startSleepSequence(REFRESH_SLEEP_WHEN_IDLE);
+	}
+
+	while (_refreshState != REFRESH_IDLE) {
+		switch (_refreshState) {
+			case REFRESH_RESET_LOW:
+				if (isDelayPending()) {
+					return true;
+				}
+				digitalWrite(_deviceResetPin, HIGH);
+				startDelay(_resetRecoveryMillis);
+				_refreshState = REFRESH_RESET_HIGH;
+				break;
+			case REFRESH_RESET_HIGH:
+				if (isDelayPending()) {
+					return true;
+				}
+				_powerState = POWER_STATE_RESET;
+				DEBUG_PRINT(F("sending configuration with size = "));
+				DEBUG_PRINT(_descriptor.configuration.size);
+				DEBUG_PRINT(F("\n"));
+				startRefreshSequence(REFRESH_CONFIGURE, _descriptor.configuration.bytes, _descriptor.configuration.size);
+				break;
+			case REFRESH_CONFIGURE:
+			case REFRESH_POWER_ON:
+			case REFRESH_LUT:
+			case REFRESH_IMAGE:
+			case REFRESH_SLEEP:
+			case REFRESH_SLEEP_WHEN_IDLE:
+				switch (stepSequence()) {
+					case SEQUENCE_WAITING:
+						return true;
+					case SEQUENCE_ADVANCED:
+						break;
+					case SEQUENCE_TIMEOUT:
+						_powerState = POWER_STATE_UNKNOWN;
+						if (_refreshState == REFRESH_SLEEP_WHEN_IDLE) {
+							// the next refresh will reset the device
+							_refreshState = REFRESH_IDLE;
+						} else if (_refreshRetriesRemaining > 0) {
+							DEBUG_PRINTLN(F("Restarting refresh after busy timeout."));
+							REFRESH_STATS(_stats.retries++);
+							_refreshRetriesRemaining--;
+							startResetPulse();
+						} else {
+							DEBUG_PRINTLN(F("Abandoning refresh after busy timeout."));
+							_refreshResult = REFRESH_RESULT_BUSY_TIMEOUT;
+							_shownImageHashValid = false;
+							_refreshState = REFRESH_IDLE;
+							REFRESH_STATS(finishStats());
+						}
+						break;
+					case SEQUENCE_DONE:
+						finishRefreshSequence();
+						break;
+				}
+				break;
+			default:
+				_refreshState = REFRESH_IDLE;
+				break;
+		}
+	}
+	return false;
+}
+
+/*!
+    @brief  Pushes the current image buffer contents to the ePaper device.
+    @return REFRESH_RESULT_OK, REFRESH_RESULT_SKIPPED if the device already shows the
+    		image, or REFRESH_RESULT_BUSY_TIMEOUT if the device never became ready.
     @note   Pushes the current buffer contents to the ePaper device, and then triggers
     		a display refresh. This function does not return until the display refresh 
-    		has completed.
+    		has completed. Use beginRefresh() and poll() to refresh without blocking.
 */
-void ePaperDisplay::refreshDisplay(void)
+ePaperRefreshResult ePaperDisplay::refreshDisplay(void)
 {
-	initializeDevice();
-	DEBUG_PRINTLN(F("Starting display refresh sequence."));
-	sendCommandAndDataSequenceFromProgMem(
-		ePaperDeviceConfigurations::setImageAndRefreshCMD(model()),
-		ePaperDeviceConfigurations::setImageAndRefreshCMDSize(model())
-	);
+	// finish anything already in progress first
+	while (!beginRefresh()) {
+		poll();
+		yield();
+	}
+	return runRefreshToCompletion();
+}
+
+/*!
+    @brief  Pushes the part of the image buffer within a rectangle to the ePaper device
+    		and refreshes that part of the screen.
+    @param	x	left edge of the rectangle in the current rotation.
+    @param	y	top edge of the rectangle in the current rotation.
+    @param	w	width of the rectangle.
+    @param	h	height of the rectangle.
+    @return REFRESH_RESULT_OK, REFRESH_RESULT_SKIPPED if the device already shows the
+    		image, or REFRESH_RESULT_BUSY_TIMEOUT if the device never became ready.
+    @note   Does not return until the refresh has completed. Use beginRefreshRegion() 
+    		and poll() to refresh without blocking.
+*/
+ePaperRefreshResult ePaperDisplay::refreshRegion( int16_t x, int16_t y, int16_t w, int16_t h )
+{
+	while (!beginRefreshRegion(x, y, w, h)) {
+		poll();
+		yield();
+	}
+	return runRefreshToCompletion();
 }
 
+/*!
+    @brief  Pushes the area of the image buffer drawn to since the last full or changes 
+    		refresh to the ePaper device and refreshes that part of the screen.
+    @return REFRESH_RESULT_OK, REFRESH_RESULT_SKIPPED if the device already shows the
+    		image, or REFRESH_RESULT_BUSY_TIMEOUT if the device never became ready.
+    @note   Does not return until the refresh has completed. Use beginRefreshChanges() 
+    		and poll() to refresh without blocking.
+*/
+ePaperRefreshResult ePaperDisplay::refreshChanges(void)
+{
+	while (!beginRefreshChanges()) {
+		poll();
+		yield();
+	}
+	return runRefreshToCompletion();
+}
+
+ePaperRefreshResult ePaperDisplay::runRefreshToCompletion(void)
+{
+	while (poll()) {
+		if (_sequenceWaitingForReady) {
+			// nothing to do until the BUSY pin changes. let the system idle.
+			delay(1);
+		}
+		yield();
+		if (_waitCallbackFunc) _waitCallbackFunc();
+	}
+	return _refreshResult;
+}
+
+/*!
+    @brief  Powers off the device and puts it into deep sleep, regardless of the
+    		power policy.
+    @return None (void).
+    @note   Does not return until the device is asleep. The next refresh will start
+    		with a hardware reset.
+*/
+void ePaperDisplay::sleepDevice(void)
+{
+	while (isBusy()) {
+		poll();
+		yield();
+	}
+	if ((_powerState == POWER_STATE_DEEP_SLEEP)||(_powerState == POWER_STATE_UNKNOWN)) {
+		return;
+	}
+	startSleepSequence(REFRESH_SLEEP_WHEN_IDLE);
+	while (poll()) {
+		yield();
+		if (_waitCallbackFunc) _waitCallbackFunc();
+	}
+}
+
+
+/*!
+    @brief  Sets the waveform LUTs used by the following refreshes.
+    @param	lutSequence		the command sequence in PROGMEM that uploads the LUTs, or
+    						nullptr for the device's default LUTs.
+    @param	sequenceSize	the size of the sequence.
+    @return None (void).
+    @note   Has no effect on devices that take their LUTs from OTP memory unless the
+    		sequence also changes the device's configuration to use register LUTs. The
+    		LUTs are uploaded by the next refresh if the device does not have them, and
+    		a change of LUTs keeps that refresh from being skipped as unchanged.
+*/
+void ePaperDisplay::setLUT( const uint8_t *lutSequence, uint16_t sequenceSize )
+{
+	if (lutSequence == nullptr) {
+		lutSequence = _descriptor.lut.bytes;
+		sequenceSize = _descriptor.lut.size;
+	}
+	if (lutSequence != _lut) {
+		// the image shown was drawn with the other waveform, so refresh it again
+		_shownImageHashValid = false;
+	}
+	_lut = lutSequence;
+	_lutSize = sequenceSize;
+}
 
 /*!
     @brief  Clear contents of display buffer (set all pixels to off).
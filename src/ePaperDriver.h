@@ -25,34 +25,237 @@
 #include <Adafruit_GFX.h>
 #include "ePaperCanvas.h"
 #include "ePaperDeviceModels.h"
+#include "ePaperTransport.h"
 
+//
+// The number of bytes sent per SPI block transfer when streaming image planes to
+// the device. A scratch buffer of this size is placed on the stack while sending.
+// Must be a multiple of 4.
+//
+#ifndef ePaper_SPI_CHUNK_SIZE
+#define ePaper_SPI_CHUNK_SIZE	64
+#endif
+
+//
+// Set to 1 to have ePaperDisplay time each phase of a refresh and count the bytes and
+// BUSY pin polls involved, available from lastRefreshStats(). When 0, none of the
+// counters or their code are compiled in. Must be set identically for every file
+// including this header, e.g. through the build flags.
+//
+#ifndef ePaper_REFRESH_STATS
+#define ePaper_REFRESH_STATS	0
+#endif
+
+//
+// The number of command sequences ePaperDisplay compiles into a list of operations
+// held in RAM on first use. Compiled sequences send each command and its data in a
+// single chip select frame. Sequences beyond this number are interpreted from PROGMEM
+// each time they are run. Set to 0 to save the RAM.
+//
+#ifndef ePaper_COMPILED_SEQUENCE_SLOTS
+#define ePaper_COMPILED_SEQUENCE_SLOTS	8
+#endif
+
+#if ePaper_REFRESH_STATS
+typedef struct {
+	uint32_t phaseMicros[PHASE_COUNT];	// indexed by ePaperRefreshPhase
+	uint32_t totalMicros;
+	uint32_t busyWaitMicros;			// time waiting on the BUSY pin, across all phases
+	uint32_t commandBytes;
+	uint32_t dataBytes;					// excludes image planes
+	uint32_t planeBytes;
+	uint16_t busyPolls;					// BUSY pin reads while waiting
+	uint8_t retries;					// restarts after a busy timeout
+} ePaperRefreshStats;
+#endif
 
+typedef enum {
+	REFRESH_RESULT_OK,
+	REFRESH_RESULT_SKIPPED,			// the device already shows the image
+	REFRESH_RESULT_BUSY_TIMEOUT		// device stayed busy through every retry
+} ePaperRefreshResult;
+
+typedef enum {
+	REFRESH_MODE_FULL,				// the device's full waveform, with all its colors or gray levels
+	REFRESH_MODE_FAST				// a short black and white waveform when the image allows it
+} ePaperRefreshMode;
 
 class ePaperDisplay : public ePaperCanvas {
 public:
 
 	
 private:
+	typedef enum {
+		REFRESH_IDLE,
+		REFRESH_RESET_LOW,
+		REFRESH_RESET_HIGH,
+		REFRESH_CONFIGURE,
+		REFRESH_POWER_ON,
+		REFRESH_LUT,
+		REFRESH_IMAGE,
+		REFRESH_SLEEP,
+		REFRESH_SLEEP_WHEN_IDLE
+	} RefreshState;
+
+	// A command sequence directive, with any data that follows a command
+	typedef struct {
+		uint8_t directive;			// the sequence directive, or SEQUENCE_OP_DATA
+		uint8_t value;				// the command, phase or power state
+		uint16_t dataIndex;			// where the data is in the sequence
+		uint16_t dataSize;			// data byte count, or the delay in milliseconds
+	} SequenceOp;
+
+	typedef struct {
+		const uint8_t *sequence;
+		uint16_t sequenceSize;
+		SequenceOp *ops;
+		uint8_t opCount;
+	} CompiledSequence;
+
+	typedef enum {
+		SEQUENCE_ADVANCED,
+		SEQUENCE_WAITING,
+		SEQUENCE_DONE,
+		SEQUENCE_TIMEOUT
+	} SequenceStatus;
+
+	// Up to two displays can have their BUSY pin serviced by an interrupt. Any
+	// further displays, or pins without interrupt support, poll the BUSY pin.
+	static ePaperDisplay *busyInterruptOwners[2];
+	static void busyInterruptSlot0(void);
+	static void busyInterruptSlot1(void);
+	void busyPinReleased(void);
+
 	const ePaperDeviceModel _model;
+	const ePaperModelDescriptor _descriptor;
 	const int _deviceReadyPin;
 	const int _deviceResetPin;
 	const int _deviceDataCommandPin;
 	const int _deviceSelectPin;
 	
-	const uint8_t *_configuration;
-	const uint8_t _configurationSize;
-	
 	void (*_waitCallbackFunc)(void);
+	void (*_transferCompleteCallbackFunc)(void);
+
+	ePaperSPITransport _spiTransport;
+	ePaperTransport *_transport;
+	uint8_t *_transferPlane;
+	bool _transferPlaneInverted;
+
+	RefreshState _refreshState;
+	const uint8_t *_sequence;
+	const SequenceOp *_sequenceOps;
+	uint16_t _sequenceSize;
+	uint16_t _sequenceIndex;
+	bool _sequenceWaitingForReady;
+	unsigned long _delayStartMillis;
+	uint16_t _delayMillis;
+
+	int8_t _busyInterruptSlot;
+	volatile bool _busyReleased;
+	volatile unsigned long _busyReleasedMillis;
+	unsigned long _busyWaitStartMillis;
+	unsigned long _busyNextPollMillis;
+	uint16_t _busyPollIntervalMillis;
+	uint32_t _busyTimeoutMillis;
+	uint8_t _busyTimeoutRetries;
+	uint8_t _refreshRetriesRemaining;
+	uint16_t _resetPulseMillis;
+	uint16_t _resetRecoveryMillis;
+	ePaperRefreshResult _refreshResult;
+	ePaperPowerState _powerState;
+	ePaperPowerPolicy _powerPolicy;
+	uint32_t _idleSleepMillis;
+	unsigned long _idleSinceMillis;
+	bool _deviceImageValid;
+	const uint8_t *_lut;
+	uint16_t _lutSize;
+	const uint8_t *_loadedLUT;
+	ePaperRefreshMode _refreshMode;
+	bool _refreshFast;
+	bool _refreshInitializeOnly;
+	bool _refreshRegion;
+	bool _refreshCoversDirtyRect;
+	bool _skipUnchangedImage;
+	bool _shownImageHashValid;
+	uint32_t _shownImageHash;
+	bool _shownImageFast;
+	uint32_t _refreshImageHash;
+	uint16_t _regionByteX0;
+	uint16_t _regionByteX1;
+	uint16_t _regionY0;
+	uint16_t _regionY1;
+
+#if ePaper_COMPILED_SEQUENCE_SLOTS
+	CompiledSequence _compiledSequences[ePaper_COMPILED_SEQUENCE_SLOTS];
+
+	const CompiledSequence *findCompiledSequence( const uint8_t *dataArray, uint16_t arraySize );
+	static SequenceOp *compileSequence( const uint8_t *dataArray, uint16_t arraySize, uint8_t& opCount );
+	static bool mergeSequenceOps( SequenceOp& prior, const SequenceOp& op );
+#endif
+
+#if ePaper_REFRESH_STATS
+	mutable ePaperRefreshStats _stats;
+	ePaperRefreshPhase _statsPhase;
+	ePaperRefreshPhase _statsPlaneReturnPhase;
+	unsigned long _statsPhaseStartMicros;
+	unsigned long _statsRefreshStartMicros;
+	unsigned long _statsBusyWaitStartMicros;
+
+	void startStats(void);
+	void setStatsPhase( ePaperRefreshPhase phase );
+	void finishStats(void);
+#endif
 	
-	void waitForReady(void) const;
-	void resetDriver(void) const;
+	bool isDeviceBusy(void) const;
+	void setDataMode( bool isData ) const;
+	void selectDevice( bool selected ) const;
+	void writeData( const uint8_t *dataArray, uint32_t arraySize, bool isProgMem, bool invertBits ) const;
+	void startDelay( uint16_t delayMillis );
+	bool isDelayPending(void);
+	void attachBusyInterrupt(void);
+	void startBusyWait(void);
+	SequenceStatus checkBusyWait(void);
+	void startResetPulse(void);
+	void startRefreshSequence( RefreshState state, const uint8_t *dataArray, uint16_t arraySize );
+	void finishRefreshSequence(void);
+	void startSleepSequence( RefreshState state );
+	void startImageSequence(void);
+	void sendRegionImage(void);
+	void sendRegionPlane( const uint8_t *plane, bool invertBits );
+	void sendDeviceRows( const uint8_t *plane, uint16_t row0, uint16_t row1, uint16_t byteX, uint16_t byteCount, bool invertBits );
+	void startRefresh(void);
+	bool isImageShown(void);
+	bool usesFastRefresh(void) const;
+	void startDeviceRegionRefresh( int16_t x, int16_t y, int16_t w, int16_t h );
+	ePaperRefreshResult runRefreshToCompletion(void);
+
+	void beginSequence( const uint8_t *dataArray, uint16_t arraySize);
+	SequenceStatus stepSequence(void);
+	void executeSequenceOp( const SequenceOp& op );
+	void executeSequenceByteCode(void);
+	void runSequenceToCompletion(void);
 	
 protected:
 	void sendCommand( uint8_t cmd ) const;
-	void sendData( const uint8_t *dataArray, uint16_t arraySize, bool isProgMem, bool invertBits = false ) const;
-	void sendCommandAndDataSequenceFromProgMem( const uint8_t *dataArray, uint16_t arraySize) const;
+	void sendData( const uint8_t *dataArray, uint32_t arraySize, bool isProgMem, bool invertBits = false ) const;
+	void sendCommandWithData( uint8_t cmd, const uint8_t *dataArray, uint32_t arraySize, bool isProgMem ) const;
+	void sendCommandAndDataSequenceFromProgMem( const uint8_t *dataArray, uint16_t arraySize);
+
+	void startPlaneTransfer( uint8_t *plane, bool invertBits );
+	void sendImagePlane( uint8_t *plane, bool invertBits );
+	bool isTransferInProgress(void);
+	void waitForTransferComplete(void);
 
-	void initializeDevice(void) const;
+	ePaperRefreshResult initializeDevice(void);
+
+	ePaperDisplay(
+		ePaperDeviceModel model,
+		const ePaperModelDescriptor& descriptor,
+		int deviceReadyPin,
+		int deviceResetPin,
+		int deviceDataCommandPin,
+		int deviceSelectPin
+	);
 
 public:
 	ePaperDisplay(
@@ -66,17 +269,115 @@ public:
 	virtual ~ePaperDisplay();
 	
 	ePaperDeviceModel model(void) const			{ return _model; }
+	const ePaperModelDescriptor& descriptor(void) const
+												{ return _descriptor; }
 
 	void setWaitCallBackFunction( void (*fp)(void) )
 												{ _waitCallbackFunc = fp; }
+	void setTransferCompleteCallBackFunction( void (*fp)(void) )
+												{ _transferCompleteCallbackFunc = fp; }
+
+	// Replaces the SPI transport used to talk to the device. Pass nullptr to
+	// restore the default. The transport must outlive this object.
+	void setTransport( ePaperTransport *transport )
+												{ _transport = transport ? transport : &_spiTransport; }
 	
 	//
 	//
 	//
 	
-	void refreshDisplay(void);
+	ePaperRefreshResult refreshDisplay(void);
 	void clearDisplay(void);
 
+	// Pushes only the part of the image buffer within the passed rectangle, given in the
+	// current rotation, and refreshes only that part of the screen. The rectangle is
+	// widened to whole bytes of the device's rows. Needs the device to have kept the
+	// last image, so a full refresh is done instead after a hardware reset, which the
+	// POWER_POLICY_ALWAYS_SLEEP power policy causes for every refresh, or if the
+	// device does not support partial refreshes.
+	ePaperRefreshResult refreshRegion( int16_t x, int16_t y, int16_t w, int16_t h );
+
+	// Refreshes only the area drawn to since the last refreshDisplay() or 
+	// refreshChanges(), as a refresh region. Does nothing if nothing was drawn.
+	ePaperRefreshResult refreshChanges(void);
+
+	// When enabled, which is the default, refreshDisplay() and refreshChanges() return
+	// REFRESH_RESULT_SKIPPED without touching the device if the image buffer holds
+	// the same image as the last of them to complete.
+	void setSkipUnchangedImage( bool skip )		{ _skipUnchangedImage = skip; }
+
+	// Sets the waveform used by the following refreshes. REFRESH_MODE_FAST pushes only
+	// the black image and drives it with a short black and white waveform, on devices
+	// that have one, treating any color plane as empty. A refresh of an image with 
+	// color or gray pixels always uses the full waveform.
+	void setRefreshMode( ePaperRefreshMode mode )
+												{ _refreshMode = mode; }
+	ePaperRefreshMode refreshMode(void) const	{ return _refreshMode; }
+
+	// Sets how long a wait on the device's BUSY pin may take before the refresh is
+	// restarted with a hardware reset, and how many times that is tried before the
+	// refresh is abandoned. A timeout of 0 waits forever.
+	void setBusyTimeout( uint32_t timeoutMillis, uint8_t retries )
+												{ _busyTimeoutMillis = timeoutMillis; _busyTimeoutRetries = retries; }
+	bool usesBusyInterrupt(void) const			{ return _busyInterruptSlot >= 0; }
+
+	// Sets how long the hardware reset holds the RST pin low, and how long it waits
+	// afterwards before configuring the device. The model's defaults are conservative,
+	// so a device that is known to cope can be reset faster with shorter timings.
+	void setResetTiming( uint16_t pulseMillis, uint16_t recoveryMillis )
+												{ _resetPulseMillis = pulseMillis; _resetRecoveryMillis = recoveryMillis; }
+
+	//
+	// Non-blocking refresh
+	//
+
+	bool beginRefresh(void);
+	bool beginRefreshRegion( int16_t x, int16_t y, int16_t w, int16_t h );
+	bool beginRefreshChanges(void);
+	bool poll(void);
+	bool isBusy(void) const						{ return _refreshState != REFRESH_IDLE; }
+
+	//
+	// Power state
+	//
+
+	// The power state the device was left in by the last command sequence. The
+	// hardware reset and configuration are skipped by a refresh when not needed.
+	ePaperPowerState powerState(void) const		{ return _powerState; }
+
+	// Call if the device lost power or was otherwise disturbed, so that the next
+	// refresh starts with a hardware reset.
+	void markPowerStateUnknown(void)			{ _powerState = POWER_STATE_UNKNOWN; _deviceImageValid = false; _shownImageHashValid = false; _loadedLUT = nullptr; }
+
+	// Sets what is done with the device after each refresh. With
+	// POWER_POLICY_SLEEP_WHEN_IDLE, the device is put to sleep by poll() once no
+	// refresh has been started for idleSeconds, so keep calling poll().
+	void setPowerPolicy( ePaperPowerPolicy policy, uint16_t idleSeconds = 0 )
+												{ _powerPolicy = policy; _idleSleepMillis = (uint32_t)idleSeconds*1000; }
+	ePaperPowerPolicy powerPolicy(void) const	{ return _powerPolicy; }
+	void sleepDevice(void);
+
+	//
+	// Waveform LUTs
+	//
+
+	// Sets the command sequence that uploads the waveform LUTs used by the following
+	// refreshes, for devices that take their LUTs from registers. The sequence must be
+	// in PROGMEM, such as the bytes of an ePaperCommandSequence. Pass nullptr to 
+	// restore the device's default LUTs. The LUTs are only uploaded when the device does
+	// not have them already, so switching between a few LUT sets costs at most one 
+	// upload per switch.
+	void setLUT( const uint8_t *lutSequence, uint16_t sequenceSize );
+	bool isLUTLoaded(void) const				{ return (_lut == nullptr)||(_loadedLUT == _lut); }
+	ePaperRefreshResult lastRefreshResult(void) const
+												{ return _refreshResult; }
+
+#if ePaper_REFRESH_STATS
+	// Timings and counters of the most recent refresh
+	const ePaperRefreshStats& lastRefreshStats(void) const
+												{ return _stats; }
+#endif
+
 };
 
 #endif // __ePaperDriver__
@@ -0,0 +1,415 @@
+//     ePaper Driver Lib for Arduino Project
+//     Copyright (C) 2019 Michael Kamprath
+//
+//     This file is part of ePaper Driver Lib for Arduino Project.
+//
+//     ePaper Driver Lib for Arduino Project is free software: you can
+//	   redistribute it and/or modify it under the terms of the GNU General Public License
+//     as published by the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     ePaper Driver Lib for Arduino Project is distributed in the hope that
+// 	   it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with Shift Register LED Matrix Project.  If not, see <http://www.gnu.org/licenses/>.
+//
+//     This project and its creators are not associated with Crystalfontz, Good display
+//	   or any other manufacturer, nor is this  project officially endorsed or reviewed for
+//	   correctness by any ePaper manufacturer.
+//
+
+#ifndef __ePaperModelDescriptors__
+#define __ePaperModelDescriptors__
+#include <Arduino.h>
+#include "ePaperDeviceConfigurations.h"
+#include "ePaperSettings.h"
+
+//
+// The descriptor of each device model, as a compile time constant:
+//
+//		constexpr ePaperModelDescriptor d = ePaperSettings::modelDescriptor<GDEW042T2>();
+//
+// Only the command sequences of the models whose descriptors are used end up in the
+// program. A new model needs its descriptor here and an entry in the run time table
+// in ePaperDeviceConfigurations.cpp.
+//
+
+namespace ePaperSettings {
+
+	template<typename Sequence> constexpr ePaperSequenceRef sequence(void)
+	{
+		return { Sequence::bytes, sizeof(Sequence::bytes) };
+	}
+
+	constexpr ePaperSequenceRef noSequence(void)
+	{
+		return { nullptr, 0 };
+	}
+
+	template<ePaperDeviceModel Model> constexpr ePaperModelDescriptor modelDescriptor(void);
+
+	//
+	// Crystalfontz CFAP200200A1-0154 - 1.54 Inch B&W
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<CFAP200200A1_0154>(void)
+	{
+		return {
+			200, 200,	// width, height
+			CMODE_BW,
+			true, false,	// inverted black bits, inverted color bits
+			HIGH,	// busy value. documentation says LOW, but sample code and reality say HIGH
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_SSD_RAM,
+			sequence<deviceConfiguration_CFAP200200A1_0154>(),	// configuration
+			noSequence(),	// power on. powers itself up and down with each update
+			sequence<setFullScreenImage_CMD_CFAP200200A1_0154>(),	// set image and refresh
+			sequence<lut_CMD_CFAP200200A1_0154>(),	// waveform LUTs
+			sequence<refreshRegion_CMD_CFAP200200A1_0154>(),	// refresh region
+			noSequence(),	// set image and fast refresh
+			noSequence(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_CFAP200200A1_0154>()	// sleep
+		};
+	}
+
+	//
+	// Crystalfontz CFAP104212C0-0213 - 2.13 Inch 3-color, red
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<CFAP104212C0_0213>(void)
+	{
+		return {
+			104, 212,	// width, height
+			CMODE_3COLOR,
+			false, false,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX,
+			sequence<deviceConfiguration_CFAP104212E0_0213>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_3color>(),	// set image and refresh
+			noSequence(),	// waveform LUTs. uses the LUTs in OTP memory
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			sequence<setImageFast_CMD_UC81xx>(),	// set image and fast refresh
+			sequence<lut_CMD_UC81xx_fast>(),	// fast refresh LUTs
+			sequence<lutOTP_CMD_3color>(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Crystalfontz CFAP104212E0-0213 - 2.13 Inch 3-color, yellow
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<CFAP104212E0_0213>(void)
+	{
+		return {
+			104, 212,	// width, height
+			CMODE_3COLOR,
+			false, false,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX,
+			sequence<deviceConfiguration_CFAP104212E0_0213>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_3color>(),	// set image and refresh
+			noSequence(),	// waveform LUTs. uses the LUTs in OTP memory
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			sequence<setImageFast_CMD_UC81xx>(),	// set image and fast refresh
+			sequence<lut_CMD_UC81xx_fast>(),	// fast refresh LUTs
+			sequence<lutOTP_CMD_3color>(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Crystalfontz CFAP176264A0-0270 - 2.7 Inch 3-color
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<CFAP176264A0_0270>(void)
+	{
+		return {
+			176, 264,	// width, height
+			CMODE_3COLOR,
+			false, false,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_NONE,
+			sequence<deviceConfiguration_GDEW027C44>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_3color>(),	// set image and refresh
+			noSequence(),	// waveform LUTs. uses the LUTs in OTP memory
+			noSequence(),	// refresh region
+			noSequence(),	// set image and fast refresh
+			noSequence(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Crystalfontz CFAP400300A0-0420 - 4.2 Inch 3-color, red
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<CFAP400300A0_420>(void)
+	{
+		return {
+			400, 300,	// width, height
+			CMODE_3COLOR,
+			false, false,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX_WIDE,
+			sequence<deviceConfiguration_CFAP4003002A0_0420>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_3color>(),	// set image and refresh
+			noSequence(),	// waveform LUTs. uses the LUTs in OTP memory
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			noSequence(),	// set image and fast refresh
+			noSequence(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Crystalfontz CFAP400300C0-0420 - 4.2 Inch 3-color, yellow
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<CFAP400300C0_420>(void)
+	{
+		return {
+			400, 300,	// width, height
+			CMODE_3COLOR,
+			false, false,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX_WIDE,
+			sequence<deviceConfiguration_CFAP4003002A0_0420>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_3color>(),	// set image and refresh
+			noSequence(),	// waveform LUTs. uses the LUTs in OTP memory
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			noSequence(),	// set image and fast refresh
+			noSequence(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Good Display GDEW026Z39 - 2.6 Inch 3-color
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<GDEW026Z39>(void)
+	{
+		return {
+			152, 296,	// width, height
+			CMODE_3COLOR,
+			true, true,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX,
+			sequence<deviceConfiguration_GDEW026Z39>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_3color>(),	// set image and refresh
+			noSequence(),	// waveform LUTs. uses the LUTs in OTP memory
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			sequence<setImageFast_CMD_UC81xx>(),	// set image and fast refresh
+			sequence<lut_CMD_UC81xx_fast>(),	// fast refresh LUTs
+			sequence<lutOTP_CMD_3color>(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Good Display GDEW027C44 - 2.7 Inch 3-color
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<GDEW027C44>(void)
+	{
+		return {
+			176, 264,	// width, height
+			CMODE_3COLOR,
+			false, false,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_NONE,
+			sequence<deviceConfiguration_GDEW027C44>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_3color>(),	// set image and refresh
+			noSequence(),	// waveform LUTs. uses the LUTs in OTP memory
+			noSequence(),	// refresh region
+			noSequence(),	// set image and fast refresh
+			noSequence(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Good Display GDEW029Z10 - 2.9 Inch 3-color
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<GDEW029Z10>(void)
+	{
+		return {
+			128, 296,	// width, height
+			CMODE_3COLOR,
+			true, true,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX,
+			sequence<deviceConfiguration_GDEW029Z10>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_3color>(),	// set image and refresh
+			noSequence(),	// waveform LUTs. uses the LUTs in OTP memory
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			sequence<setImageFast_CMD_UC81xx>(),	// set image and fast refresh
+			sequence<lut_CMD_UC81xx_fast>(),	// fast refresh LUTs
+			sequence<lutOTP_CMD_3color>(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Good Display GDEW0371Z80 - 3.71 Inch 3-color
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<GDEW0371Z80>(void)
+	{
+		return {
+			240, 416,	// width, height
+			CMODE_3COLOR,
+			true, false,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX,
+			sequence<deviceConfiguration_GDEW0371Z80>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_3color>(),	// set image and refresh
+			noSequence(),	// waveform LUTs. uses the LUTs in OTP memory
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			noSequence(),	// set image and fast refresh
+			noSequence(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Good Display GDEW0371W7 - 3.71 Inch 4 gray scale
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<GDEW0371W7>(void)
+	{
+		return {
+			240, 416,	// width, height
+			CMODE_4GRAY,
+			true, true,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX,
+			sequence<deviceConfiguration_GDEW0371W7>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_4gray>(),	// set image and refresh
+			sequence<lut_CMD_4gray>(),	// waveform LUTs
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			sequence<setImageFast_CMD_UC81xx>(),	// set image and fast refresh
+			sequence<lut_CMD_UC81xx_fast>(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Good Display GDEW042T2 - 4.2 Inch 4 gray scale
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<GDEW042T2>(void)
+	{
+		return {
+			400, 300,	// width, height
+			CMODE_4GRAY,
+			true, true,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX_WIDE,
+			sequence<deviceConfiguration_GDEW042T2>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_4gray>(),	// set image and refresh
+			sequence<lut_CMD_4gray>(),	// waveform LUTs
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			sequence<setImageFast_CMD_UC81xx>(),	// set image and fast refresh
+			sequence<lut_CMD_UC81xx_fast>(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Good Display GDEW0154T8 - 1.54 Inch 4 gray scale
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<GDEW0154T8>(void)
+	{
+		return {
+			152, 152,	// width, height
+			CMODE_4GRAY,
+			true, true,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX,
+			sequence<deviceConfiguration_GDEW0154T8>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_4gray>(),	// set image and refresh
+			sequence<lut_CMD_4gray>(),	// waveform LUTs
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			sequence<setImageFast_CMD_UC81xx>(),	// set image and fast refresh
+			sequence<lut_CMD_UC81xx_fast>(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Good Display GDEW029T5 - 2.9 Inch 4 gray scale
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<GDEW029T5>(void)
+	{
+		return {
+			128, 296,	// width, height
+			CMODE_4GRAY,
+			true, true,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX,
+			sequence<deviceConfiguration_GDEW029T5>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_4gray>(),	// set image and refresh
+			sequence<lut_CMD_4gray>(),	// waveform LUTs
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			sequence<setImageFast_CMD_UC81xx>(),	// set image and fast refresh
+			sequence<lut_CMD_UC81xx_fast>(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+
+	//
+	// Good Display GDEW0213T5 - 2.13 Inch 4 gray scale
+	//
+	template<> constexpr ePaperModelDescriptor modelDescriptor<GDEW0213T5>(void)
+	{
+		return {
+			104, 212,	// width, height
+			CMODE_4GRAY,
+			true, true,	// inverted black bits, inverted color bits
+			LOW,	// busy value
+			200, 200,	// reset pulse and recovery milliseconds
+			PARTIAL_WINDOW_UC81XX,
+			sequence<deviceConfiguration_GDEW0213T5>(),	// configuration
+			sequence<powerOn_CMD_UC81xx>(),	// power on
+			sequence<setImage_CMD_4gray>(),	// set image and refresh
+			sequence<lut_CMD_4gray>(),	// waveform LUTs
+			sequence<refreshRegion_CMD_UC81xx>(),	// refresh region
+			sequence<setImageFast_CMD_UC81xx>(),	// set image and fast refresh
+			sequence<lut_CMD_UC81xx_fast>(),	// fast refresh LUTs
+			noSequence(),	// OTP LUTs
+			sequence<sleep_CMD_UC81xx>()	// sleep
+		};
+	}
+};
+
+#endif // __ePaperModelDescriptors__
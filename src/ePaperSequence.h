@@ -0,0 +1,167 @@
+//     ePaper Driver Lib for Arduino Project
+//     Copyright (C) 2019 Michael Kamprath
+//
+//     This file is part of ePaper Driver Lib for Arduino Project.
+//
+//     ePaper Driver Lib for Arduino Project is free software: you can
+//	   redistribute it and/or modify it under the terms of the GNU General Public License
+//     as published by the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     ePaper Driver Lib for Arduino Project is distributed in the hope that
+// 	   it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with Shift Register LED Matrix Project.  If not, see <http://www.gnu.org/licenses/>.
+//
+//     This project and its creators are not associated with Crystalfontz, Good display
+//	   or any other manufacturer, nor is this  project officially endorsed or reviewed for
+//	   correctness by any ePaper manufacturer.
+//
+
+#ifndef __ePaperSequence__
+#define __ePaperSequence__
+#include <Arduino.h>
+#include "ePaperDeviceConfigurations.h"
+
+//
+// Compile time builder for the command sequences run by ePaperDisplay. A sequence is
+// declared as a list of elements:
+//
+//		typedef ePaperCommandSequence<
+//			Cmd<0x00>,					// panel setting
+//			Data<0x0F, 0x0D>,
+//			Cmd<0x04>,					// power on
+//			WaitReady,
+//			PowerState<POWER_STATE_POWERED>
+//		> someSequence;
+//
+// The elements are turned into the byte code described above
+// ePaperDisplay::sendCommandAndDataSequenceFromProgMem(), which is placed in PROGMEM
+// as someSequence::bytes and is sizeof(someSequence::bytes) long. Data block lengths
+// are counted by the compiler, and a sequence that has a data block or image plane
+// not following a command fails to compile.
+//
+
+namespace ePaperSequence {
+
+	template<uint8_t... Bytes> struct ByteList {};
+
+	typedef enum {
+		KIND_START,			// nothing yet
+		KIND_COMMAND,
+		KIND_DATA,
+		KIND_PLANE,
+		KIND_CONTROL		// waits, delays and markers
+	} ElementKind;
+
+	//
+	// Sequence elements
+	//
+
+	// Sends a command byte
+	template<uint8_t Command> struct Cmd {
+		typedef ByteList<0x00, Command> bytes;
+		static constexpr ElementKind kind = KIND_COMMAND;
+		static constexpr bool canFollow(ElementKind) { return true; }
+	};
+
+	// Sends data bytes for the preceding command
+	template<uint8_t... Bytes> struct Data {
+		static_assert(sizeof...(Bytes) > 0, "a data block needs at least one byte");
+		static_assert(sizeof...(Bytes) < 0xF0, "a data block can have at most 239 bytes");
+		typedef ByteList<sizeof...(Bytes), Bytes...> bytes;
+		static constexpr ElementKind kind = KIND_DATA;
+		static constexpr bool canFollow(ElementKind prior)
+										{ return (prior == KIND_COMMAND)||(prior == KIND_DATA); }
+	};
+
+	// Waits until the device is no longer busy
+	struct WaitReady {
+		typedef ByteList<0xFF> bytes;
+		static constexpr ElementKind kind = KIND_CONTROL;
+		static constexpr bool canFollow(ElementKind) { return true; }
+	};
+
+	// Waits a number of milliseconds, up to 255
+	template<uint8_t Millis> struct DelayMs {
+		static_assert(Millis > 0, "a delay needs at least one millisecond");
+		typedef ByteList<0xFE, Millis> bytes;
+		static constexpr ElementKind kind = KIND_CONTROL;
+		static constexpr bool canFollow(ElementKind) { return true; }
+	};
+
+	// Sends the black image plane as data for the preceding command
+	struct SendBlack {
+		typedef ByteList<0xFD> bytes;
+		static constexpr ElementKind kind = KIND_PLANE;
+		static constexpr bool canFollow(ElementKind prior) { return prior == KIND_COMMAND; }
+	};
+
+	// Sends the color image plane, if the device has one, as data for the preceding command
+	struct SendColor {
+		typedef ByteList<0xFC> bytes;
+		static constexpr ElementKind kind = KIND_PLANE;
+		static constexpr bool canFollow(ElementKind prior) { return prior == KIND_COMMAND; }
+	};
+
+	// Marks the start of a refresh phase
+	template<ePaperRefreshPhase P> struct Phase {
+		static_assert(P < PHASE_COUNT, "not a refresh phase");
+		typedef ByteList<0xFB, (uint8_t)P> bytes;
+		static constexpr ElementKind kind = KIND_CONTROL;
+		static constexpr bool canFollow(ElementKind) { return true; }
+	};
+
+	// Notes the power state the device is in after the preceding elements
+	template<ePaperPowerState S> struct PowerState {
+		typedef ByteList<0xFA, (uint8_t)S> bytes;
+		static constexpr ElementKind kind = KIND_CONTROL;
+		static constexpr bool canFollow(ElementKind) { return true; }
+	};
+
+	//
+	// Sequence assembly
+	//
+
+	template<typename A, typename B> struct Join;
+	template<uint8_t... A, uint8_t... B> struct Join< ByteList<A...>, ByteList<B...> > {
+		typedef ByteList<A..., B...> type;
+	};
+
+	template<typename... Elements> struct Concat {
+		typedef ByteList<> type;
+	};
+	template<typename First, typename... Rest> struct Concat<First, Rest...> {
+		typedef typename Join<typename First::bytes, typename Concat<Rest...>::type>::type type;
+	};
+
+	template<ElementKind Prior, typename... Elements> struct IsWellFormed {
+		static constexpr bool value = true;
+	};
+	template<ElementKind Prior, typename First, typename... Rest> struct IsWellFormed<Prior, First, Rest...> {
+		static constexpr bool value = First::canFollow(Prior) && IsWellFormed<First::kind, Rest...>::value;
+	};
+
+	template<typename List> struct ProgMemBytes;
+	template<uint8_t... Bytes> struct ProgMemBytes< ByteList<Bytes...> > {
+		static const uint8_t bytes[sizeof...(Bytes)];
+	};
+	template<uint8_t... Bytes>
+	const uint8_t ProgMemBytes< ByteList<Bytes...> >::bytes[sizeof...(Bytes)] PROGMEM = { Bytes... };
+};
+
+template<typename... Elements>
+struct ePaperCommandSequence
+	: ePaperSequence::ProgMemBytes<typename ePaperSequence::Concat<Elements...>::type>
+{
+	static_assert(sizeof...(Elements) > 0, "a command sequence needs at least one element");
+	static_assert(
+		ePaperSequence::IsWellFormed<ePaperSequence::KIND_START, Elements...>::value,
+		"data blocks must follow a command or data block, and image planes must follow a command"
+	);
+};
+
+#endif // __ePaperSequence__
@@ -1,145 +1,279 @@
 #ifndef __ePaperSettings__
 #define __ePaperSettings__
+#include "ePaperSequence.h"
+
+// The device command sequences, used through the model descriptors in 
+// ePaperModelDescriptors.h. The sequence element names are only visible within the
+// ePaperSettings namespace.
+namespace ePaperSettings {
+using namespace ePaperSequence;
+
 #include "ePaperSettings_Crystalfontz.h"
 #include "ePaperSettings_GoodDisplay.h"
 
+//
+// Powers on a configured device whose booster was powered off, as most displays
+// using the UC81xx style command set need after the power off command (0x02).
+//
+typedef ePaperCommandSequence<
+	// power on command. Always "wait for ready" after this sequence
+	Cmd<0x04>,
+	WaitReady,
+	PowerState<POWER_STATE_POWERED>
+> powerOn_CMD_UC81xx;
+
+//
+// Powers off and deep sleeps a device using the UC81xx style command set. Sent after
+// the image sequence, depending on the power policy. A hardware reset is needed to 
+// wake the device.
+//
+typedef ePaperCommandSequence<
+	//VCOM AND DATA INTERVAL SETTING
+	Phase<PHASE_POWER_OFF>,
+	Cmd<0x50>,
+	Data<0xF7>,
+
+	// power off
+	Cmd<0x02>,
+	WaitReady,
+	PowerState<POWER_STATE_INITIALIZED>,
+
+	// Deep Sleep
+	Cmd<0x07>,
+	Data<0xA5>,
+	PowerState<POWER_STATE_DEEP_SLEEP>
+> sleep_CMD_UC81xx;
+
+//
+// Refreshes the partial window on a device using the UC81xx style command set. The
+// driver enters partial mode (0x91), sets the window (0x90) and sends the window's
+// image data before this sequence is run.
+//
+typedef ePaperCommandSequence<
+	// display refresh
+	Phase<PHASE_UPDATE>,
+	Cmd<0x12>,
+	DelayMs<5>,
+	WaitReady,
+
+	// partial out
+	Cmd<0x92>
+> refreshRegion_CMD_UC81xx;
 
 // 
 // This is the command sequence for setting the image for most three-color
 // displays
 //
-const uint8_t setImage_CMD_3color[] PROGMEM = {
+typedef ePaperCommandSequence<
 	// wait until ready
-//	0xFF,
-	
+//	WaitReady,
+
 	// set black image command
-	0,	0x10,
-	
+	Cmd<0x10>,
+
 	// send black data
-	0xFD,
-	
+	SendBlack,
+
 	// set color image command
-	0,	0x13,
-	
+	Cmd<0x13>,
+
 	// send color data
-	0xFC,
-	
+	SendColor,
+
 	// display refresh command
-	0,	0x12,
-	
+	Phase<PHASE_UPDATE>,
+	Cmd<0x12>,
+
 	// wait until ready
-	0xFE, 5,
-	0xFF,
-	
-	//VCOM AND DATA INTERVAL SETTING
-	0, 0x50,
-	1, 0xF7,
+	DelayMs<5>,
+	WaitReady
+> setImage_CMD_3color;
 
-	// power off
-	0,	0x02,
-	0xFF,
-	
-	// Deep Sleep
-	0,	0x07,
-	1,	0xA5,
-};
 
-const uint16_t setImage_CMD_3color_size = 15;
+//
+// Switches a three-color display back to the waveform LUTs in its OTP memory, and so
+// to black, white and color mode, after lut_CMD_UC81xx_fast.
+//
+typedef ePaperCommandSequence<
+	Phase<PHASE_LUT_UPLOAD>,
+	Cmd<0x00>,	// panel setting
+	Data<0x0F>
+> lutOTP_CMD_3color;
+
+//
+// The waveform LUTs for most 4-level gray scale displays. These are uploaded before 
+// the image, and skipped while the device still has them.
+//
+typedef ePaperCommandSequence<
+	Phase<PHASE_LUT_UPLOAD>,
+	Cmd<0x20>,	//vcom
+	Data<0x00, 0x0A, 0x00, 0x00, 0x00, 0x01,
+		0x60, 0x14, 0x14, 0x00, 0x00, 0x01,
+		0x00, 0x14, 0x00, 0x00, 0x00, 0x01,
+		0x00, 0x13, 0x0A, 0x01, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>,
 
+	Cmd<0x21>,	// red not use
+	Data<0x40, 0x0A, 0x00, 0x00, 0x00, 0x01,
+		0x90, 0x14, 0x14, 0x00, 0x00, 0x01,
+		0x10, 0x14, 0x0A, 0x00, 0x00, 0x01,
+		0xA0, 0x13, 0x01, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>,
+
+	Cmd<0x22>,	// bw r
+	Data<0x40, 0x0A, 0x00, 0x00, 0x00, 0x01,
+		0x90, 0x14, 0x14, 0x00, 0x00, 0x01,
+		0x00, 0x14, 0x0A, 0x00, 0x00, 0x01,
+		0x99, 0x0C, 0x01, 0x03, 0x04, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>,
+
+	Cmd<0x23>,	// wb w
+	Data<0x40, 0x0A, 0x00, 0x00, 0x00, 0x01,
+		0x90, 0x14, 0x14, 0x00, 0x00, 0x01,
+		0x00, 0x14, 0x0A, 0x00, 0x00, 0x01,
+		0x99, 0x0B, 0x04, 0x04, 0x01, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>,
+
+	Cmd<0x24>,	// bb b
+	Data<0x80, 0x0A, 0x00, 0x00, 0x00, 0x01,
+		0x90, 0x14, 0x14, 0x00, 0x00, 0x01,
+		0x20, 0x14, 0x0A, 0x00, 0x00, 0x01,
+		0x50, 0x13, 0x01, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>,
+
+	Cmd<0x25>,
+	Data<0x40, 0x0A, 0x00, 0x00, 0x00, 0x01,
+		0x90, 0x14, 0x14, 0x00, 0x00, 0x01,
+		0x10, 0x14, 0x0A, 0x00, 0x00, 0x01,
+		0xA0, 0x13, 0x01, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>
+> lut_CMD_4gray;
+
+//
+// Short black and white waveform LUTs for the displays using the UC81xx style command
+// set, used by REFRESH_MODE_FAST. The panel setting selects register LUTs and black 
+// and white mode, which the 4-level gray scale displays are configured with anyway.
+// The pixels are driven by their new value alone (0x13), so the device's old data 
+// (0x10) does not matter.
+//
+typedef ePaperCommandSequence<
+	Phase<PHASE_LUT_UPLOAD>,
+	Cmd<0x00>,	// panel setting
+	Data<0x3F>,
+
+	Cmd<0x20>,	// vcom
+	Data<0x00, 0x19, 0x01, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>,
+
+	Cmd<0x21>,	// ww
+	Data<0x80, 0x19, 0x01, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>,
+
+	Cmd<0x22>,	// bw
+	Data<0x80, 0x19, 0x01, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>,
+
+	Cmd<0x23>,	// wb
+	Data<0x40, 0x19, 0x01, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>,
+
+	Cmd<0x24>,	// bb
+	Data<0x40, 0x19, 0x01, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>,
+
+	Cmd<0x25>,
+	Data<0x80, 0x19, 0x01, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00>
+> lut_CMD_UC81xx_fast;
 
 //
 // This is the command sequence for most 4-level gray scale displays
 //
 
-const uint8_t setImage_CMD_4gray[] PROGMEM = {
+typedef ePaperCommandSequence<
 	// set black image command
-	0,	0x10,
-	
+	Cmd<0x10>,
+
 	// send black data
-	0xFD,
-	
+	SendBlack,
+
 	// set color image command
-	0,	0x13,
-	
+	Cmd<0x13>,
+
 	// send color data
-	0xFC,
-	
-	// set LUT information
-	
-	0, 0x20,		//vcom
-	42,	0x00  ,0x0A ,0x00 ,0x00 ,0x00 ,0x01,
-		0x60  ,0x14 ,0x14 ,0x00 ,0x00 ,0x01,
-		0x00  ,0x14 ,0x00 ,0x00 ,0x00 ,0x01,
-		0x00  ,0x13 ,0x0A ,0x01 ,0x00 ,0x01,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-	
-	0, 0x21,    // red not use
-	42,	0x40  ,0x0A ,0x00 ,0x00 ,0x00 ,0x01,
-		0x90  ,0x14 ,0x14 ,0x00 ,0x00 ,0x01,
-		0x10  ,0x14 ,0x0A ,0x00 ,0x00 ,0x01,
-		0xA0  ,0x13 ,0x01 ,0x00 ,0x00 ,0x01,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-	
-	0, 0x22,		// bw r
-	42,	0x40  ,0x0A ,0x00 ,0x00 ,0x00 ,0x01,
-		0x90  ,0x14 ,0x14 ,0x00 ,0x00 ,0x01,
-		0x00  ,0x14 ,0x0A ,0x00 ,0x00 ,0x01,
-		0x99  ,0x0C ,0x01 ,0x03 ,0x04 ,0x01,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-
-	0, 0x23,		// wb w
-	42,	0x40  ,0x0A ,0x00 ,0x00 ,0x00 ,0x01,
-		0x90  ,0x14 ,0x14 ,0x00 ,0x00 ,0x01,
-		0x00  ,0x14 ,0x0A ,0x00 ,0x00 ,0x01,
-		0x99  ,0x0B ,0x04 ,0x04 ,0x01 ,0x01,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-
-	0, 0x24,		// bb b
-	42,	0x80  ,0x0A ,0x00 ,0x00 ,0x00 ,0x01,
-		0x90  ,0x14 ,0x14 ,0x00 ,0x00 ,0x01,
-		0x20  ,0x14 ,0x0A ,0x00 ,0x00 ,0x01,
-		0x50  ,0x13 ,0x01 ,0x00 ,0x00 ,0x01,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-
-	0, 0x25,
-	42,	0x40  ,0x0A ,0x00 ,0x00 ,0x00 ,0x01,
-		0x90  ,0x14 ,0x14 ,0x00 ,0x00 ,0x01,
-		0x10  ,0x14 ,0x0A ,0x00 ,0x00 ,0x01,
-		0xA0  ,0x13 ,0x01 ,0x00 ,0x00 ,0x01,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
-		0x00  ,0x00 ,0x00 ,0x00 ,0x00 ,0x00,
+	SendColor,
 
 	// display refresh command
-	0,	0x12,
-	
+	Phase<PHASE_UPDATE>,
+	Cmd<0x12>,
+
 	// wait until ready
-	0xFE, 5,
-	0xFF,
-	
-	//VCOM AND DATA INTERVAL SETTING
-	0, 0x50,
-	1, 0xF7,
-	
-	//power off
-	0, 0x02,
-	0xff,
+	DelayMs<5>,
+	WaitReady
+> setImage_CMD_4gray;
+
+//
+// Sends only the black image for a REFRESH_MODE_FAST refresh of a display using the
+// UC81xx style command set. Needs lut_CMD_UC81xx_fast.
+//
+typedef ePaperCommandSequence<
+	// set new image command
+	Cmd<0x13>,
 	
-	//deep sleep
-	0, 0x07,
-	1, 0xA5,
-};
+	// send black data
+	SendBlack,
 
-const uint16_t setImage_CMD_4gray_size = 292;
+	// display refresh command
+	Phase<PHASE_UPDATE>,
+	Cmd<0x12>,
+
+	// wait until ready
+	DelayMs<5>,
+	WaitReady
+> setImageFast_CMD_UC81xx;
+
+};
 
 #endif // __ePaperSettings__
@@ -25,128 +25,150 @@
 // This file contains all the device specific configurations for the Crystalfontz brand
 // ePaper devices this library supports. 
 
-// the configuration is set up as a byte stream configuration bytes, commands, and data.
-// The first byte read in a stream indicates whether the following bytes are a command or 
-// data. If the byte is 0, then the next single byte is a command. If the byte is greater
-// than 0 but less than 255 (0xFF), then it indicates the number of following bytes that 
-// should be sent as data. If the byte is 255 (OxFF), then this library will wait until
-// the ePaper device is ready, as indicated by its BUSY pin going high. This
-// byte sequence can then be repeated to construct longer command and data sequences. 
-// 
-// Given that the data size indicated is an uint8_t and that 0xFF is reserved, any given data 
-// block can only be 254 bytes in size. if more need to be sent, then just define multiple 
-// consecutive  data blocks.
+// Each configuration is a command sequence built with ePaperCommandSequence, see
+// ePaperSequence.h. Its elements are turned into a byte stream of commands, data and
+// directives for the driver, such as waiting until the ePaper device is ready as
+// indicated by its BUSY pin. The sizes of the data blocks are counted by the compiler.
+// Any given data block can only be 239 bytes in size. if more need to be sent, then
+// just define multiple consecutive data blocks.
 
 // 
 // Model CFAP200200A1-0154 - 1.54 Inch B&W ePaper display
 // 
 // 
-const uint8_t deviceConfiguration_CFAP200200A1_0154[] PROGMEM = 
-{
+typedef ePaperCommandSequence<
 	// panel setting command
-	0,	0x01,	
-	3,	0xC7,	0x00,	0x00,
+	Cmd<0x01>,
+	Data<0xC7, 0x00, 0x00>,
 
 	// soft start
-	0,	0x0C,
-	3,	0xD7,	0xD6,	0x9D,
+	Cmd<0x0C>,
+	Data<0xD7, 0xD6, 0x9D>,
 
 	// VCOMVol
-	0,	0x2c,
-	1,	0x7f,
-	
+	Cmd<0x2c>,
+	Data<0x7f>,
+
 	//dummy line per gate
-	0,	0x3A,
-	1,	0x1A,
-	
+	Cmd<0x3A>,
+	Data<0x1A>,
+
 	// RAM data entry sequence
-	0,	0x11,
-	1,	0x01,
-};
+	Cmd<0x11>,
+	Data<0x01>
+> deviceConfiguration_CFAP200200A1_0154;
 
-const uint8_t setFullScreenImage_CMD_CFAP200200A1_0154[] PROGMEM = {
-			
+typedef ePaperCommandSequence<
 	// waveform LUT
-	0,	0x32,
-	30,	0x66,    0x66,	  0x44,	  0x66,	  0xAA,	  0x11,	  0x80,	  0x08,	  0x11,	  0x18,	  0x81,	  0x18,	  0x11,	  0x88,	  0x11,	  0x88,	  0x11,	  0x88,	  0x00,	  0x00,	  0xFF,	  0xFF,	  0xFF,	  0xFF,	  0x5F,	  0xAF,	  0xFF,	  0xFF,	  0x2F,	  0x00,
-	
+	Phase<PHASE_LUT_UPLOAD>,
+	Cmd<0x32>,
+	Data<0x66, 0x66, 0x44, 0x66, 0xAA, 0x11, 0x80, 0x08, 0x11, 0x18, 0x81, 0x18, 0x11, 0x88, 0x11, 0x88, 0x11, 0x88, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x5F, 0xAF, 0xFF, 0xFF, 0x2F, 0x00>
+> lut_CMD_CFAP200200A1_0154;
+
+typedef ePaperCommandSequence<
 	// RAMX Start/End
-	0,	0x44,
-	2,	0x00,	0x18,
-	
+	Phase<PHASE_IMAGE>,
+	Cmd<0x44>,
+	Data<0x00, 0x18>,
+
 	// RAMY Start/End
-	0,	0x45,
-	4,	0xC7,	0x00,	0x00,	0x00,
+	Cmd<0x45>,
+	Data<0xC7, 0x00, 0x00, 0x00>,
 
 	// set RAMX address counter
-	0,	0x4E,
-	1,	0x00,
-	
+	Cmd<0x4E>,
+	Data<0x00>,
+
 	// set RAMX address counter
-	0,	0x4F,
-	2,	0xC7,	0x00,
-	
+	Cmd<0x4F>,
+	Data<0xC7, 0x00>,
+
 	// wait for ready
-	0xFF,
+	WaitReady,
 
 	// set black image command
-	0,	0x24,
-	
+	Cmd<0x24>,
+
 	// send black data
-	0xFD,
+	SendBlack,
 
 	// display update using LUT in RAM
-	0,	0x22,
-	1,	0xC7,
-	
+	Phase<PHASE_UPDATE>,
+	Cmd<0x22>,
+	Data<0xC7>,
+
 	// Image update
-	0,	0x20,
-	0,	0xFF,
+	Cmd<0x20>,
+	Cmd<0xFF>,
 
 	// wait until ready
-	0xFF	
-	
-};	
+	WaitReady
+> setFullScreenImage_CMD_CFAP200200A1_0154;	
+
+//
+// Updates the display after the driver has set the RAM window and address counters
+// and sent the window's image data.
+//
+typedef ePaperCommandSequence<
+	// display update using LUT in RAM
+	Phase<PHASE_UPDATE>,
+	Cmd<0x22>,
+	Data<0xC7>,
+
+	// Image update
+	Cmd<0x20>,
+	Cmd<0xFF>,
+
+	// wait until ready
+	WaitReady
+> refreshRegion_CMD_CFAP200200A1_0154;
+
+typedef ePaperCommandSequence<
+	// deep sleep mode
+	Phase<PHASE_POWER_OFF>,
+	Cmd<0x10>,
+	Data<0x01>,
+	PowerState<POWER_STATE_DEEP_SLEEP>
+> sleep_CMD_CFAP200200A1_0154;
 
 //
 // Model CFAP104212E0-0213 - 2.13 Inch 3-color ePaper display
 //
 
-const uint8_t deviceConfiguration_CFAP104212E0_0213[] PROGMEM = 
-{
+typedef ePaperCommandSequence<
 	// panel setting command
-	0,	0x01,	
-	5,	0x03,	0x00,	0x2B,	0x2B,	0x03,
+	Cmd<0x01>,
+	Data<0x03, 0x00, 0x2B, 0x2B, 0x03>,
 
 	// booster soft start
-	0,	0x06,
-	3,	0x17,	0x17,	0x17,
+	Cmd<0x06>,
+	Data<0x17, 0x17, 0x17>,
 
 	// power on command. Always "wait for ready" after this sequence
-	0,	0x04,
-	0xFF,		// wait for ready
+	Cmd<0x04>,
+	WaitReady,	// wait for ready
+	PowerState<POWER_STATE_POWERED>,
 
 	// Panel Setting
-	0,	0x00,
-	1,	0x0F,
-		
+	Cmd<0x00>,
+	Data<0x0F>,
+
 	// PLL Control
-	0,	0x30,
-	1,	0x3a,
-	
+	Cmd<0x30>,
+	Data<0x3a>,
+
 	//Resolution
-	0,	0x61,
-	3,	0x68,	0x00,	0xD4,
-	
+	Cmd<0x61>,
+	Data<0x68, 0x00, 0xD4>,
+
 	//VCOM_DC Setting
-	0,	0x82,
-	1,	0x28,
-	
+	Cmd<0x82>,
+	Data<0x28>,
+
 	//Vcom and data interval setting
-	0,	0x50,
-	1,	0x87
-};
-const uint8_t deviceConfigurationSize_CFAP104212E0_0213 PROGMEM = 39;
+	Cmd<0x50>,
+	Data<0x87>
+> deviceConfiguration_CFAP104212E0_0213;
 
 //
 // MODEL CFAP176264A0-0270 - 2.7 inch 3-color ePaper display
@@ -157,40 +179,39 @@ const uint8_t deviceConfigurationSize_CFAP104212E0_0213 PROGMEM = 39;
 //
 // MODEL CFAP4003002A0-0420 - 4.2 INCH 3-Color ePaper Display
 //
-const uint8_t deviceConfiguration_CFAP4003002A0_0420[] PROGMEM = 
-{
+typedef ePaperCommandSequence<
 	// panel setting command
-	0,	0x01,	
-	5,	0x03,	0x00,	0x0A,	0x00,	0x03,
+	Cmd<0x01>,
+	Data<0x03, 0x00, 0x0A, 0x00, 0x03>,
 
 	// booster soft start
-	0,	0x06,
-	3,	0x17,	0x17,	0x17,
-	
+	Cmd<0x06>,
+	Data<0x17, 0x17, 0x17>,
+
 	// power on command. Always "wait for ready" after this sequence
-	0,	0x04,
-	0xFF,		// wait for ready
+	Cmd<0x04>,
+	WaitReady,	// wait for ready
+	PowerState<POWER_STATE_POWERED>,
 
 	// Panel Setting
-	0,	0x00,
-	1,	0x0F,
-		
+	Cmd<0x00>,
+	Data<0x0F>,
+
 	// PLL Control
-	0,	0x30,
-	1,	0x29,
-	
+	Cmd<0x30>,
+	Data<0x29>,
+
 	//Resolution
-	0,	0x61,
-	4,	0x01,	0x90,	0x01,	0x2C,
-	
+	Cmd<0x61>,
+	Data<0x01, 0x90, 0x01, 0x2C>,
+
 	//VCOM_DC Setting
-	0,	0x82,
-	1,	0x28,
-	
+	Cmd<0x82>,
+	Data<0x28>,
+
 	//Vcom and data interval setting
-	0,	0x50,
-	1,	0x87
-};
-const uint8_t deviceConfigurationSize_CFAP4003002A0_0420 PROGMEM = 40;
+	Cmd<0x50>,
+	Data<0x87>
+> deviceConfiguration_CFAP4003002A0_0420;
 
 #endif // __ePaperSettings_Crystalfontz__
@@ -0,0 +1,197 @@
+//     ePaper Driver Lib for Arduino Project
+//     Copyright (C) 2019 Michael Kamprath
+//
+//     This file is part of ePaper Driver Lib for Arduino Project.
+// 
+//     ePaper Driver Lib for Arduino Project is free software: you can 
+//	   redistribute it and/or modify it under the terms of the GNU General Public License
+//     as published by the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     ePaper Driver Lib for Arduino Project is distributed in the hope that 
+// 	   it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+//     You should have received a copy of the GNU General Public License
+//     along with Shift Register LED Matrix Project.  If not, see <http://www.gnu.org/licenses/>.
+//
+//     This project and its creators are not associated with Crystalfontz, Good display
+//	   or any other manufacturer, nor is this  project officially endorsed or reviewed for 
+//	   correctness by any ePaper manufacturer. 
+//
+#include <Arduino.h>
+#include "ePaperTextCache.h"
+
+ePaperTextCache::ePaperTextCache(uint32_t budgetBytes)
+	:	_head(nullptr),
+		_tail(nullptr)
+{
+	memset(&_stats, 0, sizeof(_stats));
+	_stats.budgetBytes = budgetBytes;
+}
+
+ePaperTextCache::~ePaperTextCache()
+{
+	clear();
+}
+
+// FNV-1a over the key
+uint32_t ePaperTextCache::hashKey(
+	const GFXfont *font,
+	uint8_t sizeX, uint8_t sizeY,
+	const uint8_t *text,
+	uint16_t length
+)
+{
+	uint32_t hash = (2166136261UL ^ (uint32_t)(uintptr_t)font)*16777619UL;
+	hash = (hash ^ sizeX)*16777619UL;
+	hash = (hash ^ sizeY)*16777619UL;
+	for (uint16_t i = 0; i < length; i++) {
+		hash = (hash ^ text[i])*16777619UL;
+	}
+	return hash;
+}
+
+/*!
+    @brief  Looks up the image of some text, making it the most recently used entry.
+    @param	font	the font, as passed to setFont().
+    @param	sizeX, sizeY	the text size.
+    @param	text	the text, which need not be null terminated.
+    @param	length	the number of characters of text.
+    @return the entry, or null if the cache does not have it.
+*/
+ePaperTextCache::Entry *ePaperTextCache::find(
+	const GFXfont *font,
+	uint8_t sizeX, uint8_t sizeY,
+	const uint8_t *text,
+	uint16_t length
+)
+{
+	uint32_t hash = hashKey(font, sizeX, sizeY, text, length);
+	for (Entry *entry = _head; entry != nullptr; entry = entry->next) {
+		if ((entry->hash == hash)
+				&&(entry->font == font)
+				&&(entry->sizeX == sizeX)
+				&&(entry->sizeY == sizeY)
+				&&(entry->textLength == length)
+				&&(memcmp(entry->text(), text, length) == 0)
+		) {
+			if (entry != _head) {
+				unlink(entry);
+				pushFront(entry);
+			}
+			_stats.hits++;
+			return entry;
+		}
+	}
+	_stats.misses++;
+	return nullptr;
+}
+
+/*!
+    @brief  Adds an entry for some text, as the most recently used entry.
+    @param	font, sizeX, sizeY, text, length	the key, see find().
+    @param	width, height	the dimensions of the text's image.
+    @return the entry, whose image is cleared and the other fields other than the key
+    		are for the caller to set. null if the entry would not fit in the budget or
+    		could not be allocated.
+    @note   Least recently used entries are freed until the new entry fits.
+*/
+ePaperTextCache::Entry *ePaperTextCache::add(
+	const GFXfont *font,
+	uint8_t sizeX, uint8_t sizeY,
+	const uint8_t *text,
+	uint16_t length,
+	int16_t width, int16_t height
+)
+{
+	uint32_t imageSize = ((uint32_t)width*height + 7)/8;
+	uint32_t size = sizeof(Entry) + length + imageSize;
+	if (size > _stats.budgetBytes) {
+		return nullptr;
+	}
+	trimToBudget(_stats.budgetBytes - size);
+	Entry *entry = (Entry *)malloc(size);
+	if (entry == nullptr) {
+		return nullptr;
+	}
+	entry->font = font;
+	entry->hash = hashKey(font, sizeX, sizeY, text, length);
+	entry->textLength = length;
+	entry->sizeX = sizeX;
+	entry->sizeY = sizeY;
+	entry->width = width;
+	entry->height = height;
+	memcpy(entry->text(), text, length);
+	memset(entry->image(), 0, imageSize);
+
+	pushFront(entry);
+	_stats.bytesUsed += size;
+	_stats.entries++;
+	return entry;
+}
+
+void ePaperTextCache::unlink(Entry *entry)
+{
+	if (entry->prior != nullptr) {
+		entry->prior->next = entry->next;
+	} else {
+		_head = entry->next;
+	}
+	if (entry->next != nullptr) {
+		entry->next->prior = entry->prior;
+	} else {
+		_tail = entry->prior;
+	}
+}
+
+void ePaperTextCache::pushFront(Entry *entry)
+{
+	entry->prior = nullptr;
+	entry->next = _head;
+	if (_head != nullptr) {
+		_head->prior = entry;
+	} else {
+		_tail = entry;
+	}
+	_head = entry;
+}
+
+// frees the least recently used entries until no more than budget bytes are used
+void ePaperTextCache::trimToBudget(uint32_t budget)
+{
+	while ((_tail != nullptr)&&(_stats.bytesUsed > budget)) {
+		Entry *last = _tail;
+		unlink(last);
+		_stats.bytesUsed -= sizeof(Entry) + last->textLength + last->imageSize();
+		_stats.entries--;
+		_stats.evictions++;
+		free(last);
+	}
+}
+
+void ePaperTextCache::clear(void)
+{
+	while (_head != nullptr) {
+		Entry *entry = _head;
+		_head = entry->next;
+		free(entry);
+	}
+	_tail = nullptr;
+	_stats.bytesUsed = 0;
+	_stats.entries = 0;
+}
+
+/*!
+    @brief  Sets the most RAM the entries can use, freeing the least recently used
+    		entries that no longer fit.
+    @param	budgetBytes	the budget, counting each entry's header, text and image but
+    					not the heap's own overhead.
+    @return None (void).
+*/
+void ePaperTextCache::setBudget(uint32_t budgetBytes)
+{
+	_stats.budgetBytes = budgetBytes;
+	trimToBudget(budgetBytes);
+}
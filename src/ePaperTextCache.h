@@ -0,0 +1,109 @@
+//     ePaper Driver Lib for Arduino Project
+//     Copyright (C) 2019 Michael Kamprath
+//
+//     This file is part of ePaper Driver Lib for Arduino Project.
+// 
+//     ePaper Driver Lib for Arduino Project is free software: you can 
+//	   redistribute it and/or modify it under the terms of the GNU General Public License
+//     as published by the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     ePaper Driver Lib for Arduino Project is distributed in the hope that 
+// 	   it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+//     You should have received a copy of the GNU General Public License
+//     along with Shift Register LED Matrix Project.  If not, see <http://www.gnu.org/licenses/>.
+//
+//     This project and its creators are not associated with Crystalfontz, Good display
+//	   or any other manufacturer, nor is this  project officially endorsed or reviewed for 
+//	   correctness by any ePaper manufacturer. 
+//
+#ifndef __ePaperTextCache__
+#define __ePaperTextCache__
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+
+typedef struct {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;			// entries freed to stay within the budget
+	uint32_t bytesUsed;			// the entries' headers, text and images
+	uint32_t budgetBytes;
+	uint16_t entries;
+} ePaperTextCacheStats;
+
+//
+// A least recently used cache of rasterized text, attached to a canvas with
+// ePaperCanvas::setTextCache(). Each entry is the image of a string, or of a single 
+// scaled glyph, in one font and text size, packed as ePaperCanvas::blitBitImage() 
+// takes it, so drawing it again is one blit per image plane. Entries are allocated 
+// from the heap, and the least recently used are freed whenever adding one would
+// take the cache over its RAM budget.
+//
+class ePaperTextCache {
+public:
+	struct Entry {
+		Entry *next;				// the next less recently used entry
+		Entry *prior;				// the next more recently used entry
+		const GFXfont *font;
+		uint32_t hash;
+		uint16_t textLength;
+		uint8_t sizeX;
+		uint8_t sizeY;
+		int16_t offsetX;			// the image's top left corner, relative to the text cursor
+		int16_t offsetY;
+		int16_t width;
+		int16_t height;
+		int16_t advance;			// how far drawing the text moves the text cursor
+
+		// the text and then the image follow the entry in the same allocation
+		uint8_t *text(void)						{ return (uint8_t *)(this + 1); }
+		uint8_t *image(void)					{ return text() + textLength; }
+		uint32_t imageSize(void) const			{ return ((uint32_t)width*height + 7)/8; }
+	};
+
+private:
+	Entry *_head;					// most recently used
+	Entry *_tail;					// least recently used, the next to be freed
+	ePaperTextCacheStats _stats;
+
+	static uint32_t hashKey(
+				const GFXfont *font,
+				uint8_t sizeX, uint8_t sizeY,
+				const uint8_t *text,
+				uint16_t length
+			);
+	void unlink(Entry *entry);
+	void pushFront(Entry *entry);
+	void trimToBudget(uint32_t budget);
+
+public:
+	ePaperTextCache(uint32_t budgetBytes);
+	virtual ~ePaperTextCache();
+
+	Entry *find(
+				const GFXfont *font,
+				uint8_t sizeX, uint8_t sizeY,
+				const uint8_t *text,
+				uint16_t length
+			);
+	Entry *add(
+				const GFXfont *font,
+				uint8_t sizeX, uint8_t sizeY,
+				const uint8_t *text,
+				uint16_t length,
+				int16_t width, int16_t height
+			);
+	void clear(void);
+
+	void setBudget(uint32_t budgetBytes);
+	uint32_t budget(void) const					{ return _stats.budgetBytes; }
+	uint32_t bytesUsed(void) const				{ return _stats.bytesUsed; }
+
+	const ePaperTextCacheStats& getStats(void) const	{ return _stats; }
+	void resetStats(void)						{ _stats.hits = 0; _stats.misses = 0; _stats.evictions = 0; }
+};
+
+#endif // __ePaperTextCache__
@@ -0,0 +1,121 @@
+//     ePaper Driver Lib for Arduino Project
+//     Copyright (C) 2019 Michael Kamprath
+//
+//     This file is part of ePaper Driver Lib for Arduino Project.
+// 
+//     ePaper Driver Lib for Arduino Project is free software: you can 
+//	   redistribute it and/or modify it under the terms of the GNU General Public License
+//     as published by the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     ePaper Driver Lib for Arduino Project is distributed in the hope that 
+// 	   it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+//     You should have received a copy of the GNU General Public License
+//     along with Shift Register LED Matrix Project.  If not, see <http://www.gnu.org/licenses/>.
+//
+//     This project and its creators are not associated with Crystalfontz, Good display
+//	   or any other manufacturer, nor is this  project officially endorsed or reviewed for 
+//	   correctness by any ePaper manufacturer. 
+//
+#include <Arduino.h>
+#include <SPI.h>
+#include "ePaperTransport.h"
+
+#define SPI_FALLBACK_CHUNK_SIZE	32
+
+ePaperSPITransport::ePaperSPITransport()
+	:	_busy(false)
+{
+#if ePaper_TRANSPORT_HAS_DMA
+	_event.setContext(this);
+	_event.attachImmediate(&ePaperSPITransport::transferComplete);
+#endif
+}
+
+void ePaperSPITransport::write(const uint8_t *data, uint32_t size)
+{
+#if defined(ESP32) || defined(ESP8266)
+	SPI.writeBytes((uint8_t *)data, size);
+#elif defined(TEENSYDUINO)
+	SPI.transfer(data, nullptr, size);
+#elif defined(__AVR__)
+	// the AVR buffer transfer is a byte loop too, so skip the copy
+	for (uint32_t i = 0; i < size; i++) {
+		SPI.transfer(data[i]);
+	}
+#else
+	// the generic buffer transfer overwrites its buffer with the received bytes
+	uint8_t chunk[SPI_FALLBACK_CHUNK_SIZE];
+	uint32_t index = 0;
+	while (index < size) {
+		uint16_t chunkSize = SPI_FALLBACK_CHUNK_SIZE;
+		if (size - index < SPI_FALLBACK_CHUNK_SIZE) {
+			chunkSize = size - index;
+		}
+		memcpy(chunk, &data[index], chunkSize);
+		SPI.transfer(chunk, chunkSize);
+		index += chunkSize;
+	}
+#endif
+}
+
+bool ePaperSPITransport::writeAsync(const uint8_t *data, uint32_t size)
+{
+#if ePaper_TRANSPORT_HAS_DMA
+	_busy = true;
+	if (SPI.transfer(data, nullptr, size, _event)) {
+		return true;
+	}
+	// DMA could not be started. Send it the slow way.
+	_busy = false;
+#endif
+	write(data, size);
+	return false;
+}
+
+#if ePaper_TRANSPORT_HAS_DMA
+void ePaperSPITransport::transferComplete(EventResponderRef event)
+{
+	ePaperSPITransport *transport = (ePaperSPITransport *)event.getContext();
+	transport->_busy = false;
+}
+#endif
+
+ePaperCaptureTransport::ePaperCaptureTransport(uint8_t *buffer, uint32_t capacity, uint8_t *flags)
+	:	_buffer(buffer),
+		_flags(flags),
+		_capacity(capacity),
+		_count(0),
+		_frameCount(0),
+		_isData(false),
+		_frameStarted(false)
+{
+}
+
+void ePaperCaptureTransport::write(const uint8_t *data, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++) {
+		if (_count < _capacity) {
+			if (_buffer) {
+				_buffer[_count] = data[i];
+			}
+			if (_flags) {
+				_flags[_count] = (_isData ? CAPTURE_FLAG_DATA : 0)
+									| (_frameStarted ? 0 : CAPTURE_FLAG_FRAME_START);
+			}
+		}
+		_frameStarted = true;
+		_count++;
+	}
+}
+
+void ePaperCaptureTransport::setSelected(bool selected)
+{
+	if (selected) {
+		_frameStarted = false;
+		_frameCount++;
+	}
+}
@@ -0,0 +1,129 @@
+//     ePaper Driver Lib for Arduino Project
+//     Copyright (C) 2019 Michael Kamprath
+//
+//     This file is part of ePaper Driver Lib for Arduino Project.
+// 
+//     ePaper Driver Lib for Arduino Project is free software: you can 
+//	   redistribute it and/or modify it under the terms of the GNU General Public License
+//     as published by the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     ePaper Driver Lib for Arduino Project is distributed in the hope that 
+// 	   it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+//     You should have received a copy of the GNU General Public License
+//     along with Shift Register LED Matrix Project.  If not, see <http://www.gnu.org/licenses/>.
+//
+//     This project and its creators are not associated with Crystalfontz, Good display
+//	   or any other manufacturer, nor is this  project officially endorsed or reviewed for 
+//	   correctness by any ePaper manufacturer. 
+//
+#ifndef __ePaperTransport__
+#define __ePaperTransport__
+#include <Arduino.h>
+
+//
+// Teensy 3.x and 4.x expose DMA backed SPI transfers through an EventResponder. All
+// other platforms use the blocking fallback, which is also what a transport subclass
+// gets by only implementing write().
+//
+#if defined(TEENSYDUINO) && (defined(KINETISK) || defined(__IMXRT1062__))
+#define ePaper_TRANSPORT_HAS_DMA	1
+#include <EventResponder.h>
+#else
+#define ePaper_TRANSPORT_HAS_DMA	0
+#endif
+
+//
+// A transport moves bytes to the ePaper device. The ePaperDisplay object owns the
+// D/C and CS pins and frames each command or data block before handing the bytes
+// to the transport, so a transport only needs to know how to clock bytes out. It is
+// told of each change to those pins, should it need to know how the bytes are framed.
+//
+class ePaperTransport {
+public:
+	virtual ~ePaperTransport() {}
+
+	// Sends the bytes and does not return until they are sent. The data is never modified.
+	virtual void write(const uint8_t *data, uint32_t size) = 0;
+
+	// Indicates whether writeAsync() can return before the bytes are sent.
+	virtual bool supportsAsync(void) const			{ return false; }
+
+	// Starts sending the bytes. The data must remain untouched until isBusy() returns false.
+	// Returns true if the transfer is still in progress when this method returns.
+	virtual bool writeAsync(const uint8_t *data, uint32_t size)
+												{ write(data, size); return false; }
+
+	// Indicates whether an asynchronous transfer is still in progress.
+	virtual bool isBusy(void) const					{ return false; }
+
+	// Called when the D/C pin is set, with true for data and false for a command.
+	virtual void setDataMode(bool /*isData*/)		{}
+
+	// Called when the CS pin selects the device before a frame, and deselects it after.
+	virtual void setSelected(bool /*selected*/)		{}
+};
+
+//
+// The default transport, using the Arduino SPI object.
+//
+class ePaperSPITransport : public ePaperTransport {
+private:
+	volatile bool _busy;
+#if ePaper_TRANSPORT_HAS_DMA
+	EventResponder _event;
+
+	static void transferComplete(EventResponderRef event);
+#endif
+
+public:
+	ePaperSPITransport();
+	virtual ~ePaperSPITransport() {}
+
+	virtual void write(const uint8_t *data, uint32_t size);
+	virtual bool supportsAsync(void) const			{ return ePaper_TRANSPORT_HAS_DMA; }
+	virtual bool writeAsync(const uint8_t *data, uint32_t size);
+	virtual bool isBusy(void) const					{ return _busy; }
+};
+
+//
+// Records the bytes written to it into a caller supplied buffer rather than sending
+// them anywhere. Intended for host side testing of command sequences. Bytes beyond
+// the buffer's capacity are counted but not stored. If a flags buffer of the same
+// capacity is supplied, how each byte was framed is recorded into it as a combination
+// of the CAPTURE_FLAG_* bits, so that command bytes can be told from data bytes.
+//
+#define CAPTURE_FLAG_DATA			0x01	// sent with D/C high, else a command byte
+#define CAPTURE_FLAG_FRAME_START	0x02	// first byte sent after CS selected the device
+
+class ePaperCaptureTransport : public ePaperTransport {
+private:
+	uint8_t *_buffer;
+	uint8_t *_flags;
+	uint32_t _capacity;
+	uint32_t _count;
+	uint32_t _frameCount;
+	bool _isData;
+	bool _frameStarted;
+
+public:
+	ePaperCaptureTransport(uint8_t *buffer, uint32_t capacity, uint8_t *flags = nullptr);
+	virtual ~ePaperCaptureTransport() {}
+
+	virtual void write(const uint8_t *data, uint32_t size);
+	virtual void setDataMode(bool isData)			{ _isData = isData; }
+	virtual void setSelected(bool selected);
+
+	const uint8_t *capturedBytes(void) const		{ return _buffer; }
+	const uint8_t *capturedFlags(void) const		{ return _flags; }
+	uint32_t capturedByteCount(void) const			{ return _count; }
+	uint32_t capturedFrameCount(void) const			{ return _frameCount; }
+	bool isDataByte(uint32_t index) const			{ return _flags && (index < _count) && (index < _capacity) && (_flags[index] & CAPTURE_FLAG_DATA); }
+	bool isFrameStart(uint32_t index) const			{ return _flags && (index < _count) && (index < _capacity) && (_flags[index] & CAPTURE_FLAG_FRAME_START); }
+	void clear(void)								{ _count = 0; _frameCount = 0; }
+};
+
+#endif // __ePaperTransport__
@@ -0,0 +1,61 @@
+//     ePaper Driver Lib for Arduino Project
+//     Copyright (C) 2019 Michael Kamprath
+//
+//     This file is part of ePaper Driver Lib for Arduino Project.
+// 
+//     ePaper Driver Lib for Arduino Project is free software: you can 
+//	   redistribute it and/or modify it under the terms of the GNU General Public License
+//     as published by the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     ePaper Driver Lib for Arduino Project is distributed in the hope that 
+// 	   it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+//     You should have received a copy of the GNU General Public License
+//     along with Shift Register LED Matrix Project.  If not, see <http://www.gnu.org/licenses/>.
+//
+//     This project and its creators are not associated with Crystalfontz, Good display
+//	   or any other manufacturer, nor is this  project officially endorsed or reviewed for 
+//	   correctness by any ePaper manufacturer. 
+//
+#include <Arduino.h>
+#include "ePaperYield.h"
+
+#if defined(ESP8266) || defined(ESP32)
+#define TICKS_PER_MICRO		(ESP.getCpuFreqMHz())
+#define DEFAULT_TICKS_PER_MICRO	(F_CPU/1000000L)
+#else
+#define TICKS_PER_MICRO		1
+#define DEFAULT_TICKS_PER_MICRO	1
+#endif
+
+namespace ePaperYield {
+
+	uint32_t budgetTicks = (uint32_t)ePaper_YIELD_BUDGET_MICROS*DEFAULT_TICKS_PER_MICRO;
+	uint32_t lastYieldTicks = 0;
+
+	/*!
+		@brief  Sets the time between the yields of yieldIfDue().
+		@param	micros	the budget in microseconds. 0 yields on every call.
+		@return None (void).
+		@note   On the ESP boards the budget is counted in CPU cycles, so set it again
+				after changing the CPU frequency.
+	*/
+	void setBudget(uint32_t micros)
+	{
+		budgetTicks = micros*TICKS_PER_MICRO;
+	}
+
+	uint32_t budget(void)
+	{
+		return budgetTicks/TICKS_PER_MICRO;
+	}
+
+	void yieldNow(void)
+	{
+		yield();
+		lastYieldTicks = ticks();
+	}
+};
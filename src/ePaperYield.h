@@ -0,0 +1,72 @@
+//     ePaper Driver Lib for Arduino Project
+//     Copyright (C) 2019 Michael Kamprath
+//
+//     This file is part of ePaper Driver Lib for Arduino Project.
+// 
+//     ePaper Driver Lib for Arduino Project is free software: you can 
+//	   redistribute it and/or modify it under the terms of the GNU General Public License
+//     as published by the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     ePaper Driver Lib for Arduino Project is distributed in the hope that 
+// 	   it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+//     You should have received a copy of the GNU General Public License
+//     along with Shift Register LED Matrix Project.  If not, see <http://www.gnu.org/licenses/>.
+//
+//     This project and its creators are not associated with Crystalfontz, Good display
+//	   or any other manufacturer, nor is this  project officially endorsed or reviewed for 
+//	   correctness by any ePaper manufacturer. 
+//
+#ifndef __ePaperYield__
+#define __ePaperYield__
+#include <Arduino.h>
+
+//
+// The time between yields in the drawing and image transfer loops, in microseconds.
+// Can be changed at run time with ePaperYield::setBudget(). 0 yields on every call.
+//
+#ifndef ePaper_YIELD_BUDGET_MICROS
+#define ePaper_YIELD_BUDGET_MICROS	5000
+#endif
+
+//
+// Shared yield scheduling for loops that would otherwise call yield() for every pixel
+// or byte. yieldIfDue() only yields once the budget has passed since the last yield,
+// which on the ESP boards is a cycle counter read and a compare. Sketches drawing in
+// long loops of their own can call it too, and so share the library's budget.
+//
+// On AVR boards yield() does nothing unless a scheduler replaces it, so yieldIfDue()
+// simply calls it.
+//
+namespace ePaperYield {
+
+#if defined(ESP8266) || defined(ESP32)
+	inline uint32_t ticks(void)					{ return ESP.getCycleCount(); }
+#else
+	inline uint32_t ticks(void)					{ return micros(); }
+#endif
+
+	extern uint32_t budgetTicks;
+	extern uint32_t lastYieldTicks;
+
+	void setBudget(uint32_t micros);
+	uint32_t budget(void);
+
+	// yields and starts a new budget
+	void yieldNow(void);
+
+	inline void yieldIfDue(void) {
+#if defined(__AVR__)
+		yield();
+#else
+		if ((uint32_t)(ticks() - lastYieldTicks) >= budgetTicks) {
+			yieldNow();
+		}
+#endif
+	}
+};
+
+#endif // __ePaperYield__